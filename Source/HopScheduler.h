@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Splits host blocks of any size at an engine's fixed hop boundaries.
+
+    The engine gets a segment callback for each run of samples between hops and a
+    frame callback exactly once per hop, whatever block sizes the host sends, so
+    its latency and frame timing depend only on its own hop and frame length.
+*/
+class HopScheduler
+{
+public:
+    //==============================================================================
+    HopScheduler() = default;
+
+    void prepare (int newHopSize) noexcept
+    {
+        jassert (newHopSize > 0);
+
+        hopSize = juce::jmax (1, newHopSize);
+        reset();
+    }
+
+    void reset() noexcept                               { position = 0; }
+
+    /** Calls segment (offset, length) for each run of samples that contains no hop
+        boundary, and frame() straight after the sample that completes a hop.
+    */
+    template <typename SegmentCallback, typename FrameCallback>
+    void process (int numSamples, SegmentCallback&& segment, FrameCallback&& frame) noexcept
+    {
+        for (int done = 0; done < numSamples;)
+        {
+            const int numThisTime = juce::jmin (numSamples - done, hopSize - position);
+
+            segment (done, numThisTime);
+            position += numThisTime;
+            done += numThisTime;
+
+            if (position == hopSize)
+            {
+                position = 0;
+                frame();
+            }
+        }
+    }
+
+    int getHopSize() const noexcept                     { return hopSize; }
+
+    /** Number of samples until the next frame runs. */
+    int getSamplesUntilNextHop() const noexcept         { return hopSize - position; }
+
+private:
+    //==============================================================================
+    int hopSize = 1, position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HopScheduler)
+};
@@ -0,0 +1,68 @@
+#include "MultiResolutionVocoder.h"
+
+//==============================================================================
+void MultiResolutionVocoder::setResolutions (int lowsFftSize, int lowsOverlap, int highsFftSize, int highsOverlap, float crossoverHz) noexcept
+{
+    jassert (lowsFftSize >= highsFftSize);
+
+    lows.setResolution (lowsFftSize, lowsOverlap);
+    lows.setBand (PhaseVocoder::Band::lows, crossoverHz);
+
+    highs.setResolution (highsFftSize, highsOverlap);
+    highs.setBand (PhaseVocoder::Band::highs, crossoverHz);
+}
+
+void MultiResolutionVocoder::prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena)
+{
+    lows.prepare (spec, arena);
+    highs.prepare (spec, arena);
+
+    maxBlockSize = juce::jmax (1, (int) spec.maximumBlockSize);
+    const auto delayLength = juce::jmax (0, lows.getLatencyInSamples() - highs.getLatencyInSamples());
+
+    highsDelay.prepare ((int) spec.numChannels, delayLength, maxBlockSize, arena);
+    highsDelay.setDelay (delayLength);
+
+    lowsChannels = arena.allocate<float*> (spec.numChannels);
+    highsChannels = arena.allocate<float*> (spec.numChannels);
+    for (auto& channel : highsChannels)
+        channel = arena.allocate<float> ((size_t) maxBlockSize).data();
+
+    reset();
+}
+
+void MultiResolutionVocoder::reset() noexcept
+{
+    lows.reset();
+    highs.reset();
+    highsDelay.reset();
+}
+
+//==============================================================================
+void MultiResolutionVocoder::process (float* const* channelData, int numChannels, int numSamples) noexcept
+{
+    jassert (numChannels <= (int) highsChannels.size());
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numThisTime = juce::jmin (numSamples - done, maxBlockSize);
+
+        // The lows are shifted in place, the highs on a copy of the input
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            lowsChannels[(size_t) ch] = channelData[ch] + done;
+            juce::FloatVectorOperations::copy (highsChannels[(size_t) ch], lowsChannels[(size_t) ch], numThisTime);
+        }
+
+        lows.process (lowsChannels.data(), numChannels, numThisTime);
+        highs.process (highsChannels.data(), numChannels, numThisTime);
+
+        // Delay the highs by the difference in latency and add them in
+        highsDelay.process (highsChannels.data(), numChannels, numThisTime);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::add (lowsChannels[(size_t) ch], highsChannels[(size_t) ch], numThisTime);
+
+        done += numThisTime;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MultichannelDelay.h"
+#include "PhaseVocoder.h"
+
+//==============================================================================
+/**
+    Two phase vocoders split at a crossover: long frames for the lows, where
+    partials are close together and need the frequency resolution, and short
+    frames for the highs, where attacks need the time resolution.
+
+    Both vocoders see the whole input and each keeps its own side of a
+    raised-cosine crossover on its output (see PhaseVocoder::setBand()). The
+    short vocoder's output is delayed to line up with the long one's, so the sum
+    has the long vocoder's latency. The delay lines and the highs' copy of the
+    input come from the RealtimeArena, so nothing allocates after prepare().
+*/
+class MultiResolutionVocoder
+{
+public:
+    //==============================================================================
+    MultiResolutionVocoder() = default;
+
+    /** Sets the frame sizes (at 44.1/48 kHz) and overlaps of both bands and
+        where they cross over. Call before prepare().
+    */
+    void setResolutions (int lowsFftSize, int lowsOverlap, int highsFftSize, int highsOverlap, float crossoverHz) noexcept;
+
+    /** Prepares both vocoders and takes the delay lines from the arena. Not realtime-safe. */
+    void prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena);
+
+    /** Clears both vocoders and the delay lines. */
+    void reset() noexcept;
+
+    void setPitchRatio (float newRatio) noexcept                    { lows.setPitchRatio (newRatio);   highs.setPitchRatio (newRatio); }
+    void setFormantRatio (float newRatio) noexcept                  { lows.setFormantRatio (newRatio); highs.setFormantRatio (newRatio); }
+    void setNumVoices (int newNumVoices) noexcept                   { lows.setNumVoices (newNumVoices); highs.setNumVoices (newNumVoices); }
+    void setVoicePitchRatio (int voice, float newRatio) noexcept    { lows.setVoicePitchRatio (voice, newRatio);   highs.setVoicePitchRatio (voice, newRatio); }
+    void setVoiceFormantRatio (int voice, float newRatio) noexcept  { lows.setVoiceFormantRatio (voice, newRatio); highs.setVoiceFormantRatio (voice, newRatio); }
+    void setVoiceMix (int voice, float gain, float pan) noexcept    { lows.setVoiceMix (voice, gain, pan); highs.setVoiceMix (voice, gain, pan); }
+    void setLinkedChannels (bool shouldLink) noexcept               { lows.setLinkedChannels (shouldLink); highs.setLinkedChannels (shouldLink); }
+    void setWorkerPool (RealtimeWorkerPool* pool) noexcept          { lows.setWorkerPool (pool); highs.setWorkerPool (pool); }
+    void setParallelProcessing (bool shouldRunInParallel) noexcept  { lows.setParallelProcessing (shouldRunInParallel); highs.setParallelProcessing (shouldRunInParallel); }
+    void setProfiler (StageProfiler* profiler) noexcept             { lows.setProfiler (profiler); highs.setProfiler (profiler); }
+
+    /** The long vocoder's spectra are shown: it analyses the whole band and its
+        output is only split after the display has seen it.
+    */
+    void setSpectrumFeed (SpectrumFeed* feed) noexcept              { lows.setSpectrumFeed (feed); }
+
+    /** Both bands are corrected; the long vocoder detects, since it sees low notes best. */
+    void setPitchTracker (PitchTracker* tracker) noexcept           { lows.setPitchTracker (tracker); highs.setPitchTracker (tracker); }
+    void setTracksPitch (bool shouldTrack) noexcept                 { lows.setTracksPitch (shouldTrack); }
+
+    bool isSmoothing() const noexcept                               { return lows.isSmoothing() || highs.isSmoothing(); }
+
+    /** Shifts the given channels in place. numChannels must not exceed the prepared count. */
+    void process (float* const* channelData, int numChannels, int numSamples) noexcept;
+
+    /** The long vocoder's latency, which the highs are delayed to match. */
+    int getLatencyInSamples() const noexcept                        { return lows.getLatencyInSamples(); }
+
+private:
+    //==============================================================================
+    PhaseVocoder lows, highs;
+
+    // Where each channel's lows are written, the highs' copy of it, and the delay
+    // that aligns the two
+    RealtimeArena::Array<float*> lowsChannels, highsChannels;
+    MultichannelDelay highsDelay;
+    int maxBlockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiResolutionVocoder)
+};
@@ -0,0 +1,95 @@
+#include "MultichannelDelay.h"
+
+//==============================================================================
+void MultichannelDelay::prepare (int numChannels, int newMaxDelay, int maxBlockSize, RealtimeArena& arena)
+{
+    maxDelay = juce::jmax (0, newMaxDelay);
+    maxBlock = juce::jmax (1, maxBlockSize);
+
+    // A whole block is written before any of it is read back
+    ringSize = juce::nextPowerOfTwo (maxDelay + maxBlock);
+    ringMask = ringSize - 1;
+
+    rings = arena.allocate<RealtimeArena::Array<float>> ((size_t) numChannels);
+    for (auto& ring : rings)
+        ring = arena.allocate<float> ((size_t) ringSize);
+
+    delay = juce::jmin (delay, maxDelay);
+    reset();
+}
+
+void MultichannelDelay::reset() noexcept
+{
+    for (auto& ring : rings)
+        std::fill (ring.begin(), ring.end(), 0.0f);
+
+    writePosition = 0;
+    lastWriteSize = 0;
+}
+
+//==============================================================================
+void MultichannelDelay::process (const float* const* input, float* const* output, int numChannels, int numSamples) noexcept
+{
+    for (int done = 0; done < numSamples;)
+    {
+        const auto numThisTime = juce::jmin (numSamples - done, maxBlock);
+
+        // The whole chunk goes in before any is read, so output may alias input
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = input[ch] + done;
+            auto* out = output[ch] + done;
+
+            writeChannel (ch, in, numThisTime);
+            readChannel (ch, out, numThisTime, writePosition, delay);
+        }
+
+        writePosition = (writePosition + numThisTime) & ringMask;
+        done += numThisTime;
+    }
+}
+
+void MultichannelDelay::write (const float* const* input, int numChannels, int numSamples) noexcept
+{
+    jassert (numSamples <= maxBlock);
+    numSamples = juce::jmin (numSamples, maxBlock);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        writeChannel (ch, input[ch], numSamples);
+
+    writePosition = (writePosition + numSamples) & ringMask;
+    lastWriteSize = numSamples;
+}
+
+void MultichannelDelay::read (float* const* output, int numChannels, int numSamples, int delayInSamples) const noexcept
+{
+    jassert (numSamples == lastWriteSize && delayInSamples <= maxDelay);
+
+    // Back to where the last block started, then back by the delay
+    const auto start = writePosition - lastWriteSize;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        readChannel (ch, output[ch], juce::jmin (numSamples, lastWriteSize), start, juce::jlimit (0, maxDelay, delayInSamples));
+}
+
+//==============================================================================
+void MultichannelDelay::writeChannel (int channel, const float* input, int numSamples) noexcept
+{
+    jassert (channel < (int) rings.size());
+
+    auto* ring = rings[(size_t) channel].data();
+    const auto numFirst = juce::jmin (numSamples, ringSize - writePosition);
+
+    juce::FloatVectorOperations::copy (ring + writePosition, input, numFirst);
+    juce::FloatVectorOperations::copy (ring, input + numFirst, numSamples - numFirst);
+}
+
+void MultichannelDelay::readChannel (int channel, float* output, int numSamples, int blockStart, int delayInSamples) const noexcept
+{
+    const auto* ring = rings[(size_t) channel].data();
+    const auto readPosition = (blockStart - delayInSamples) & ringMask;
+    const auto numFirst = juce::jmin (numSamples, ringSize - readPosition);
+
+    juce::FloatVectorOperations::copy (output, ring + readPosition, numFirst);
+    juce::FloatVectorOperations::copy (output + numFirst, ring, numSamples - numFirst);
+}
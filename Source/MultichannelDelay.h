@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeArena.h"
+
+//==============================================================================
+/**
+    Whole-sample delay for a set of channels, used to line signals up with an
+    engine's latency.
+
+    Each channel has a power-of-two ring taken from the RealtimeArena, long
+    enough for the longest delay plus one block, so a block is written in and
+    read back out with at most two vector copies each way. The delay can change
+    at any time up to the prepared maximum; the history is kept, so a new delay
+    takes effect straight away (with the jump that implies).
+*/
+class MultichannelDelay
+{
+public:
+    //==============================================================================
+    MultichannelDelay() = default;
+
+    /** Takes the rings from the arena. Not realtime-safe. */
+    void prepare (int numChannels, int maxDelay, int maxBlockSize, RealtimeArena& arena);
+
+    /** Fills every ring with silence. */
+    void reset() noexcept;
+
+    /** Clamped to the prepared maximum. */
+    void setDelay (int newDelay) noexcept               { delay = juce::jlimit (0, maxDelay, newDelay); }
+    int getDelay() const noexcept                       { return delay; }
+
+    /** Delays input into output; they may be the same buffers. */
+    void process (const float* const* input, float* const* output, int numChannels, int numSamples) noexcept;
+
+    /** Appends a block of at most the prepared block size, for read() to tap. */
+    void write (const float* const* input, int numChannels, int numSamples) noexcept;
+
+    /** Reads the block last written, delayed by delayInSamples (up to the
+        prepared maximum) instead of the delay set with setDelay(). Several taps
+        can be read from one write.
+    */
+    void read (float* const* output, int numChannels, int numSamples, int delayInSamples) const noexcept;
+
+    /** Delays the channels in place. */
+    void process (float* const* channelData, int numChannels, int numSamples) noexcept
+    {
+        process (channelData, channelData, numChannels, numSamples);
+    }
+
+private:
+    //==============================================================================
+    void writeChannel (int channel, const float* input, int numSamples) noexcept;
+    void readChannel (int channel, float* output, int numSamples, int blockStart, int delayInSamples) const noexcept;
+
+    RealtimeArena::Array<RealtimeArena::Array<float>> rings;
+    int ringSize = 1, ringMask = 0, maxDelay = 0, maxBlock = 0;
+    int delay = 0, writePosition = 0, lastWriteSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultichannelDelay)
+};
@@ -0,0 +1,1015 @@
+#include "PhaseVocoder.h"
+
+namespace
+{
+    // Cheap log2 and exp2 for the formant envelope, accurate to about 0.01 dB,
+    // which is far below anything the liftering resolves
+    inline float fastLog2 (float x) noexcept
+    {
+        std::uint32_t bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+
+        const auto exponent = (float) ((int) ((bits >> 23) & 0xff) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+        float m;
+        std::memcpy (&m, &bits, sizeof (m));
+
+        // Minimax fit of log2 (m) on [1, 2)
+        return exponent + (((0.15824870f * m - 1.05187502f) * m + 3.04788415f) * m - 2.15419620f);
+    }
+
+    inline float fastExp2 (float x) noexcept
+    {
+        x = juce::jlimit (-126.0f, 126.0f, x);
+
+        const auto whole = std::floor (x);
+        const auto f = x - whole;
+
+        // Minimax fit of 2^f on [0, 1)
+        const auto mantissa = 1.0f + f * (0.69583354f + f * (0.22606716f + f * 0.07944023f));
+
+        std::uint32_t bits;
+        std::memcpy (&bits, &mantissa, sizeof (bits));
+        bits += (std::uint32_t) ((int) whole) << 23;
+
+        float result;
+        std::memcpy (&result, &bits, sizeof (result));
+        return result;
+    }
+}
+
+//==============================================================================
+void PhaseVocoder::setResolution (int fftSizeAt48k, int newOverlapFactor) noexcept
+{
+    jassert (juce::isPowerOfTwo (fftSizeAt48k) && fftSizeAt48k >= 256);
+    jassert (juce::isPowerOfTwo (newOverlapFactor) && newOverlapFactor >= 2 && newOverlapFactor <= 8);
+
+    baseFftOrder = juce::jlimit (8, 13, juce::roundToInt (std::log2 ((double) fftSizeAt48k)));
+    overlapFactor = juce::jlimit (2, 8, newOverlapFactor);
+}
+
+int PhaseVocoder::getFftOrderForSampleRate (double sampleRate) const noexcept
+{
+    // The base size at 44.1/48 kHz, doubled for every doubling of the rate so the
+    // frame length in milliseconds (and so the frequency resolution) stays the same
+    int order = baseFftOrder;
+
+    for (auto rate = sampleRate; rate > 50000.0 && order < baseFftOrder + 2; rate *= 0.5)
+        ++order;
+
+    return order;
+}
+
+void PhaseVocoder::prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena)
+{
+    const auto order = getFftOrderForSampleRate (spec.sampleRate);
+
+    fftSize = 1 << order;
+    hopSize = fftSize / overlapFactor;
+    numBins = fftSize / 2 + 1;
+    paddedBins = SpectralKernels::getPaddedBinCount (numBins);
+    kernels = &SpectralKernels::getBestKernels();
+
+    // Lags the pitch detector searches, limited by what a circular autocorrelation
+    // of one frame can hold
+    minPitchLag = juce::jmax (2, (int) (spec.sampleRate / PitchTracker::maxFrequency));
+    maxPitchLag = juce::jmax (minPitchLag, juce::jmin (fftSize / 3, (int) std::ceil (spec.sampleRate / PitchTracker::minFrequency)));
+
+    const auto key = "PhaseVocoder size=" + juce::String (fftSize) + " overlap=" + juce::String (overlapFactor)
+                   + " lags=" + juce::String (maxPitchLag);
+
+    tables = SharedTables::get<Tables> (key, [this, order] (Tables& t) { buildTables (t, order); });
+    window = tables->window;
+    expectedPhase = tables->expectedPhase;
+    windowCorrelation = tables->windowCorrelation;
+    outputGain = tables->outputGain;
+
+    // A sine of amplitude A peaks at A * sum (window) / 2
+    displayGain = 2.0f / tables->windowArea;
+    binHz = (float) (spec.sampleRate / fftSize);
+
+    // Crossover weights on the output bins, a raised cosine over the octave around
+    // the crossover. The split is made after the shift, so the analysis, transient
+    // detection and formant envelope all still see the whole spectrum.
+    bandWeight = {};
+
+    if (band != Band::full)
+    {
+        bandWeight = arena.allocate<float> ((size_t) paddedBins);
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            const auto frequency = (double) k * spec.sampleRate / fftSize;
+            const auto octaves = k == 0 ? -0.5 : juce::jlimit (-0.5, 0.5, std::log2 (frequency / crossoverFrequency));
+            const auto lows = 0.5 - 0.5 * std::sin (juce::MathConstants<double>::pi * octaves);
+
+            bandWeight[(size_t) k] = (float) (band == Band::lows ? lows : 1.0 - lows);
+        }
+    }
+
+    // One set of scratch (and FFT plans, which aren't all safe to share between
+    // threads) for every thread that may process frames at the same time
+    lanes = arena.allocate<Lane> ((size_t) (workers != nullptr ? workers->getNumLanes() : 1));
+    fftPlans.clear();
+
+    for (auto& lane : lanes)
+    {
+        fftPlans.push_back (std::make_unique<juce::dsp::FFT> (order));
+        lane.fft = fftPlans.back().get();
+
+        fftPlans.push_back (std::make_unique<juce::dsp::FFT> (order - 1));
+        lane.envelopeFft = fftPlans.back().get();
+
+        lane.fftData = arena.allocate<float> ((size_t) fftSize * 2);
+
+        for (auto* bins : { &lane.real, &lane.imag, &lane.magnitude, &lane.frequency, &lane.synthMagnitude, &lane.synthFrequency, &lane.logEnvelope,
+                            &lane.mixReal, &lane.mixImag, &lane.sourceReal, &lane.sourceImag, &lane.peakReal, &lane.peakImag })
+            *bins = arena.allocate<float> ((size_t) paddedBins);
+
+        lane.sourceBin = arena.allocate<int> ((size_t) numBins);
+        lane.nearestPeak = arena.allocate<int> ((size_t) numBins);
+    }
+
+    channels = arena.allocate<ChannelState> (spec.numChannels);
+    for (auto& state : channels)
+    {
+        state.inputRing = arena.allocate<float> ((size_t) fftSize);
+        state.outputRing = arena.allocate<float> ((size_t) fftSize);
+        state.lastPhase = arena.allocate<float> ((size_t) paddedBins);
+        state.sumPhase = arena.allocate<float> ((size_t) (paddedBins * maxVoices));
+        state.spectrumReal = arena.allocate<float> ((size_t) paddedBins);
+        state.spectrumImag = arena.allocate<float> ((size_t) paddedBins);
+        state.transients.lastMagnitude = arena.allocate<float> ((size_t) paddedBins);
+    }
+
+    for (auto* bins : { &link.real, &link.imag, &link.lastPhase, &link.sumPhase, &link.phaseReal, &link.phaseImag, &link.transients.lastMagnitude })
+        *bins = arena.allocate<float> ((size_t) paddedBins);
+
+    for (auto& voice : voices)
+    {
+        voice.pitchRatio.reset (spec.sampleRate, pitchRampSeconds);
+        voice.formantRatio.reset (spec.sampleRate, pitchRampSeconds);
+    }
+    envelopeBins = fftSize / 4 + 1;
+    lifterLength = juce::jlimit (4, fftSize / 8, juce::roundToInt (spec.sampleRate * lifterSeconds));
+
+    scheduler.prepare (hopSize);
+    reset();
+}
+
+void PhaseVocoder::buildTables (Tables& t, int fftOrder) const
+{
+    // Periodic Hann, used for both analysis and synthesis. At 50% overlap its square
+    // doesn't sum to a constant, so that uses the sine window (the square root of Hann).
+    t.window = t.storage.allocate<float> ((size_t) fftSize);
+    for (int i = 0; i < fftSize; ++i)
+    {
+        const auto hann = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * (float) i / (float) fftSize);
+        t.window[(size_t) i] = overlapFactor > 2 ? hann : std::sqrt (hann);
+    }
+
+    // Overlapping squared windows sum to a constant; divide it out on resynthesis
+    float windowSum = 0.0f;
+    for (int i = 0; i < fftSize; i += hopSize)
+        windowSum += t.window[(size_t) i] * t.window[(size_t) i];
+
+    t.outputGain = 1.0f / windowSum;
+
+    t.windowArea = 0.0f;
+    for (int i = 0; i < fftSize; ++i)
+        t.windowArea += t.window[(size_t) i];
+
+    // Phase advance of each bin's centre frequency over one hop, wrapped in double
+    // precision so the kernels never have to handle the large unwrapped values
+    t.expectedPhase = t.storage.allocate<float> ((size_t) paddedBins);
+    for (int k = 0; k < numBins; ++k)
+    {
+        const auto advance = juce::MathConstants<double>::twoPi * k * hopSize / fftSize;
+        t.expectedPhase[(size_t) k] = (float) (advance - juce::MathConstants<double>::twoPi * std::round (advance / juce::MathConstants<double>::twoPi));
+    }
+
+    // The window's own (circular) autocorrelation, which shapes the frame's and is
+    // divided back out by the pitch detector
+    t.windowCorrelation = t.storage.allocate<float> ((size_t) maxPitchLag + 2);
+
+    juce::dsp::FFT fft (fftOrder);
+    std::vector<float> fftData ((size_t) fftSize * 2, 0.0f);
+    std::copy (t.window.begin(), t.window.end(), fftData.begin());
+
+    fft.performRealOnlyForwardTransform (fftData.data(), true);
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const auto re = fftData[(size_t) (2 * k)], im = fftData[(size_t) (2 * k + 1)];
+        fftData[(size_t) (2 * k)] = re * re + im * im;
+        fftData[(size_t) (2 * k + 1)] = 0.0f;
+    }
+
+    fft.performRealOnlyInverseTransform (fftData.data());
+
+    for (size_t lag = 0; lag < t.windowCorrelation.size(); ++lag)
+        t.windowCorrelation[lag] = fftData[0] / juce::jmax (fftData[lag], 1.0e-6f * fftData[0]);
+}
+
+void PhaseVocoder::reset() noexcept
+{
+    auto resetTransients = [] (TransientState& transients)
+    {
+        std::fill (transients.lastMagnitude.begin(), transients.lastMagnitude.end(), 0.0f);
+        transients.lastFlux = transients.averageFlux = 0.0f;
+        transients.lockedFramesRemaining = 0;
+    };
+
+    for (auto& state : channels)
+    {
+        std::fill (state.inputRing.begin(), state.inputRing.end(), 0.0f);
+        std::fill (state.outputRing.begin(), state.outputRing.end(), 0.0f);
+        std::fill (state.lastPhase.begin(), state.lastPhase.end(), 0.0f);
+        std::fill (state.sumPhase.begin(), state.sumPhase.end(), 0.0f);
+        resetTransients (state.transients);
+    }
+
+    std::fill (link.lastPhase.begin(), link.lastPhase.end(), 0.0f);
+    std::fill (link.sumPhase.begin(), link.sumPhase.end(), 0.0f);
+    resetTransients (link.transients);
+
+    for (auto& voice : voices)
+    {
+        voice.pitchRatio.setCurrentAndTargetValue (voice.pitchRatio.getTargetValue());
+        voice.formantRatio.setCurrentAndTargetValue (voice.formantRatio.getTargetValue());
+        voice.frameRatio = voice.pitchRatio.getCurrentValue();
+        voice.frameFormantRatio = voice.formantRatio.getCurrentValue();
+    }
+
+    ringPosition = 0;
+    scheduler.reset();
+}
+
+void PhaseVocoder::setNumVoices (int newNumVoices) noexcept
+{
+    newNumVoices = juce::jlimit (1, maxVoices, newNumVoices);
+
+    // Voices coming in start from scratch rather than from wherever they stopped
+    for (int v = numVoices; v < newNumVoices; ++v)
+    {
+        auto& voice = voices[(size_t) v];
+        voice.pitchRatio.setCurrentAndTargetValue (voice.pitchRatio.getTargetValue());
+        voice.formantRatio.setCurrentAndTargetValue (voice.formantRatio.getTargetValue());
+
+        for (auto& state : channels)
+            std::fill_n (state.sumPhase.data() + v * paddedBins, paddedBins, 0.0f);
+    }
+
+    numVoices = newNumVoices;
+}
+
+bool PhaseVocoder::isSmoothing() const noexcept
+{
+    for (int v = 0; v < numVoices; ++v)
+        if (voices[(size_t) v].pitchRatio.isSmoothing() || voices[(size_t) v].formantRatio.isSmoothing())
+            return true;
+
+    return false;
+}
+
+//==============================================================================
+void PhaseVocoder::process (float* const* channelData, int numChannels, int numSamples) noexcept
+{
+    jassert (numChannels <= (int) channels.size());
+
+    const int mask = fftSize - 1;
+
+    // Segments never straddle a hop boundary, so the inner loops never branch
+    scheduler.process (numSamples,
+        [&] (int offset, int length)
+        {
+            PITCHMORPHER_PROFILE_STAGE (profiler, inputFifo);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto& state = channels[(size_t) ch];
+                auto* data = channelData[ch] + offset;
+
+                for (int i = 0; i < length; ++i)
+                {
+                    const auto pos = (size_t) ((ringPosition + i) & mask);
+                    state.inputRing[pos] = data[i];
+                    data[i] = state.outputRing[pos];
+                    state.outputRing[pos] = 0.0f;
+                }
+            }
+
+            ringPosition = (ringPosition + length) & mask;
+        },
+        [&]
+        {
+            // One pair of ratios per voice and frame, shared by every channel. The pitch
+            // correction comes from the frames before this one, so it doesn't depend on
+            // which thread analysed them.
+            const auto correction = pitchTracker != nullptr ? pitchTracker->getCorrectionRatio() : 1.0f;
+
+            for (int v = 0; v < numVoices; ++v)
+            {
+                auto& voice = voices[(size_t) v];
+                voice.frameRatio = voice.pitchRatio.skip (hopSize) * correction;
+                voice.frameFormantRatio = voice.formantRatio.skip (hopSize);
+            }
+
+            numFrameChannels = numChannels;
+            displayFrame = spectrumFeed != nullptr ? spectrumFeed->startFrame (hopSize) : nullptr;
+
+            if (linked && numChannels > 1 && numVoices == 1)
+            {
+                forEachChannel (numChannels, [this] (int ch, Lane& lane)
+                {
+                    PITCHMORPHER_PROFILE_STAGE (profiler, analysisFft);
+                    auto& state = channels[(size_t) ch];
+                    forwardTransform (lane, state, state.spectrumReal.data(), state.spectrumImag.data());
+                });
+
+                analyseLinkedFrame (numChannels);
+
+                forEachChannel (numChannels, [this] (int ch, Lane& lane)
+                {
+                    synthesiseLinkedFrame (lane, ch);
+                });
+            }
+            else
+            {
+                forEachChannel (numChannels, [this] (int ch, Lane& lane)
+                {
+                    processFrame (lane, ch);
+                });
+            }
+
+            if (displayFrame != nullptr)
+            {
+                spectrumFeed->finishFrame();
+                displayFrame = nullptr;
+            }
+        });
+}
+
+template <typename Function>
+void PhaseVocoder::forEachChannel (int numChannels, Function&& function) noexcept
+{
+    // Channels only share read-only state within a frame, so they can go to the
+    // workers in any order; each thread works in its own lane. A pool restarted
+    // with more workers since prepare() has lanes this vocoder doesn't.
+    if (parallel && workers != nullptr && workers->getNumLanes() > 1 && workers->getNumLanes() <= (int) lanes.size())
+    {
+        workers->run (numChannels, [this, &function] (int ch, int laneIndex)
+        {
+            function (ch, lanes[(size_t) laneIndex]);
+        });
+    }
+    else
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            function (ch, lanes[0]);
+    }
+}
+
+void PhaseVocoder::forwardTransform (Lane& lane, const ChannelState& state, float* realOut, float* imagOut) noexcept
+{
+    auto& fftData = lane.fftData;
+
+    // Unroll the input ring (oldest sample first) and apply the analysis window
+    const auto oldest = (size_t) ringPosition;
+    const auto firstPart = (size_t) fftSize - oldest;
+
+    for (size_t i = 0; i < firstPart; ++i)
+        fftData[i] = state.inputRing[oldest + i] * window[i];
+
+    for (size_t i = firstPart; i < (size_t) fftSize; ++i)
+        fftData[i] = state.inputRing[i - firstPart] * window[i];
+
+    lane.fft->performRealOnlyForwardTransform (fftData.data(), true);
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        realOut[k] = fftData[(size_t) (2 * k)];
+        imagOut[k] = fftData[(size_t) (2 * k + 1)];
+    }
+
+    if (displayFrame != nullptr && &state == channels.data())
+        spectrumFeed->writeBands (displayFrame->input, realOut, imagOut, numBins, binHz, displayGain);
+}
+
+void PhaseVocoder::inverseTransform (Lane& lane, ChannelState& state, const float* realIn, const float* imagIn) noexcept
+{
+    auto& fftData = lane.fftData;
+
+    if (displayFrame != nullptr && &state == channels.data())
+        spectrumFeed->writeBands (displayFrame->output, realIn, imagIn, numBins, binHz, displayGain);
+
+    if (bandWeight.size() > 0)
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            fftData[(size_t) (2 * k)]     = realIn[k] * bandWeight[(size_t) k];
+            fftData[(size_t) (2 * k + 1)] = imagIn[k] * bandWeight[(size_t) k];
+        }
+    }
+    else
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            fftData[(size_t) (2 * k)]     = realIn[k];
+            fftData[(size_t) (2 * k + 1)] = imagIn[k];
+        }
+    }
+
+    lane.fft->performRealOnlyInverseTransform (fftData.data());
+
+    // Overlap-add into the output ring; the first sample lands on the next output position
+    const int mask = fftSize - 1;
+
+    for (int i = 0; i < fftSize; ++i)
+        state.outputRing[(size_t) ((ringPosition + i) & mask)] += fftData[(size_t) i] * window[(size_t) i] * outputGain;
+}
+
+void PhaseVocoder::processFrame (Lane& lane, int channel) noexcept
+{
+    using namespace juce;
+
+    auto& state = channels[(size_t) channel];
+
+    // Analysis: magnitude and true frequency (in bins) from the phase advance
+    const float radiansPerBin = MathConstants<float>::twoPi * (float) hopSize / (float) fftSize;
+
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, analysisFft);
+
+        forwardTransform (lane, state, lane.real.data(), lane.imag.data());
+
+        kernels->analyse (lane.real.data(), lane.imag.data(), expectedPhase.data(),
+                          state.lastPhase.data(), lane.magnitude.data(), lane.frequency.data(),
+                          paddedBins, 1.0f / radiansPerBin);
+
+        if (channel == 0 && tracksPitch && pitchTracker != nullptr && pitchTracker->isEnabled())
+            trackPitch (lane, lane.magnitude.data());
+    }
+
+    auto phaseMode = PhaseMode::free;
+
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, binProcessing);
+
+        // The synthesis overwrites the spectrum, so keep it for the phase handling around onsets
+        phaseMode = detectTransient (state.transients, lane.magnitude.data());
+
+        if (phaseMode != PhaseMode::free)
+        {
+            FloatVectorOperations::copy (lane.sourceReal.data(), lane.real.data(), numBins);
+            FloatVectorOperations::copy (lane.sourceImag.data(), lane.imag.data(), numBins);
+        }
+    }
+
+    // One envelope serves every voice that moves its formants
+    for (int v = 0; v < numVoices; ++v)
+    {
+        if (voices[(size_t) v].frameFormantRatio != voices[(size_t) v].frameRatio)
+        {
+            PITCHMORPHER_PROFILE_STAGE (profiler, formant);
+            estimateEnvelope (lane);
+            break;
+        }
+    }
+
+    // Each voice is remapped and resynthesised from the shared analysis. A single
+    // voice goes straight to the inverse transform; several are summed first.
+    const auto* outReal = lane.real.data();
+    const auto* outImag = lane.imag.data();
+
+    for (int v = 0; v < numVoices; ++v)
+    {
+        const auto& voice = voices[(size_t) v];
+        auto* sumPhase = state.sumPhase.data() + v * paddedBins;
+
+        remapVoice (lane, voice);
+
+        // Resynthesis: accumulate phase at the shifted frequencies
+        PITCHMORPHER_PROFILE_STAGE (profiler, synthesis);
+
+        kernels->synthesise (lane.synthMagnitude.data(), lane.synthFrequency.data(), expectedPhase.data(),
+                             sumPhase, lane.real.data(), lane.imag.data(),
+                             paddedBins, radiansPerBin);
+
+        applyPhaseMode (phaseMode, lane, { lane.sourceReal.data(), lane.sourceImag.data(), lane.magnitude.data(), state.lastPhase.data(),
+                                           lane.synthMagnitude.data(), sumPhase, lane.real.data(), lane.imag.data() },
+                        voice.frameRatio);
+
+        const auto weight = getVoiceWeight (v, channel);
+
+        if (numVoices == 1)
+        {
+            if (weight != 1.0f)
+            {
+                FloatVectorOperations::multiply (lane.real.data(), weight, numBins);
+                FloatVectorOperations::multiply (lane.imag.data(), weight, numBins);
+            }
+        }
+        else if (v == 0)
+        {
+            FloatVectorOperations::copyWithMultiply (lane.mixReal.data(), lane.real.data(), weight, numBins);
+            FloatVectorOperations::copyWithMultiply (lane.mixImag.data(), lane.imag.data(), weight, numBins);
+            outReal = lane.mixReal.data();
+            outImag = lane.mixImag.data();
+        }
+        else
+        {
+            FloatVectorOperations::addWithMultiply (lane.mixReal.data(), lane.real.data(), weight, numBins);
+            FloatVectorOperations::addWithMultiply (lane.mixImag.data(), lane.imag.data(), weight, numBins);
+        }
+    }
+
+    PITCHMORPHER_PROFILE_STAGE (profiler, synthesis);
+    inverseTransform (lane, state, outReal, outImag);
+}
+
+void PhaseVocoder::remapVoice (Lane& lane, const Voice& voice) noexcept
+{
+    const auto ratio = voice.frameRatio;
+
+    // Move every analysis bin to its shifted position. This scatter can collide
+    // on the same target bin, so it stays scalar.
+    std::fill (lane.synthMagnitude.begin(), lane.synthMagnitude.end(), 0.0f);
+    std::fill (lane.synthFrequency.begin(), lane.synthFrequency.end(), 0.0f);
+
+    if (voice.frameFormantRatio == ratio)
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, binProcessing);
+
+        // The envelope moves with the harmonics, so nothing needs reshaping
+        for (int k = 0; k < numBins; ++k)
+        {
+            const auto target = (int) ((float) k * ratio + 0.5f);
+
+            if (target >= numBins)
+                break;
+
+            lane.synthMagnitude[(size_t) target] += lane.magnitude[(size_t) k];
+            lane.synthFrequency[(size_t) target] = lane.frequency[(size_t) k] * ratio;
+        }
+    }
+    else
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, formant);
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            const auto target = (int) ((float) k * ratio + 0.5f);
+
+            if (target >= numBins)
+                break;
+
+            lane.synthMagnitude[(size_t) target] += lane.magnitude[(size_t) k] * getFormantGain (lane, k, target, voice.frameFormantRatio);
+            lane.synthFrequency[(size_t) target] = lane.frequency[(size_t) k] * ratio;
+        }
+    }
+}
+
+float PhaseVocoder::getVoiceWeight (int voice, int channel) const noexcept
+{
+    const auto& settings = voices[(size_t) voice];
+
+    if (numFrameChannels != 2 || settings.pan == 0.0f)
+        return settings.gain;
+
+    // Balance law: the centre leaves both sides at unity, panning fades the other side out
+    const auto away = channel == 0 ? juce::jmax (0.0f, settings.pan) : juce::jmax (0.0f, -settings.pan);
+    return settings.gain * std::cos (juce::MathConstants<float>::halfPi * away);
+}
+
+void PhaseVocoder::analyseLinkedFrame (int numChannels) noexcept
+{
+    using namespace juce;
+
+    // Frequencies, the formant envelope and the synthesis phase all come from the
+    // reference, so every channel gets the same decisions. They live in the first
+    // lane, which the per-channel synthesis only reads.
+    auto& reference = lanes[0];
+    const auto& voice = voices[0];
+    const float radiansPerBin = MathConstants<float>::twoPi * (float) hopSize / (float) fftSize;
+    auto phaseMode = PhaseMode::free;
+
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, binProcessing);
+
+        // The reference is the sum of the channels, each bin flipped where needed to lie
+        // within 90 degrees of the first channel, so out-of-phase content can't cancel
+        const auto& first = channels[0];
+        FloatVectorOperations::copy (link.real.data(), first.spectrumReal.data(), numBins);
+        FloatVectorOperations::copy (link.imag.data(), first.spectrumImag.data(), numBins);
+
+        for (int ch = 1; ch < numChannels; ++ch)
+        {
+            const auto& state = channels[(size_t) ch];
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const auto xr = state.spectrumReal[(size_t) k], xi = state.spectrumImag[(size_t) k];
+                const auto sign = xr * first.spectrumReal[(size_t) k] + xi * first.spectrumImag[(size_t) k] < 0.0f ? -1.0f : 1.0f;
+
+                link.real[(size_t) k] += sign * xr;
+                link.imag[(size_t) k] += sign * xi;
+            }
+        }
+
+        kernels->analyse (link.real.data(), link.imag.data(), expectedPhase.data(),
+                          link.lastPhase.data(), reference.magnitude.data(), reference.frequency.data(),
+                          paddedBins, 1.0f / radiansPerBin);
+
+        phaseMode = detectTransient (link.transients, reference.magnitude.data());
+    }
+
+    if (tracksPitch && pitchTracker != nullptr && pitchTracker->isEnabled())
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, analysisFft);
+        trackPitch (reference, reference.magnitude.data());
+    }
+
+    if (voice.frameFormantRatio != voice.frameRatio)
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, formant);
+        estimateEnvelope (reference);
+    }
+
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, binProcessing);
+
+        std::fill (reference.synthFrequency.begin(), reference.synthFrequency.end(), 0.0f);
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            const auto target = (int) ((float) k * voice.frameRatio + 0.5f);
+
+            if (target >= numBins)
+                break;
+
+            reference.synthFrequency[(size_t) target] = reference.frequency[(size_t) k] * voice.frameRatio;
+        }
+    }
+
+    // Unit phasors at the shared synthesis phase
+    PITCHMORPHER_PROFILE_STAGE (profiler, synthesis);
+
+    std::fill (reference.synthMagnitude.begin(), reference.synthMagnitude.end(), 1.0f);
+
+    kernels->synthesise (reference.synthMagnitude.data(), reference.synthFrequency.data(), expectedPhase.data(),
+                         link.sumPhase.data(), link.phaseReal.data(), link.phaseImag.data(),
+                         paddedBins, radiansPerBin);
+
+    applyPhaseMode (phaseMode, reference, { link.real.data(), link.imag.data(), reference.magnitude.data(), link.lastPhase.data(),
+                                            reference.synthMagnitude.data(), link.sumPhase.data(), link.phaseReal.data(), link.phaseImag.data() },
+                    voice.frameRatio);
+}
+
+void PhaseVocoder::synthesiseLinkedFrame (Lane& lane, int channel) noexcept
+{
+    // Each channel keeps its own magnitudes and its phase relative to the reference,
+    // which is what holds the image together. Both come from X * conj (ref) / |ref|,
+    // with no per-channel atan2 or sin/cos.
+    auto& state = channels[(size_t) channel];
+    const auto& reference = lanes[0];
+    const auto& voice = voices[0];
+    const auto shapeFormants = voice.frameFormantRatio != voice.frameRatio;
+    const auto weight = getVoiceWeight (0, channel);
+
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, binProcessing);
+
+        std::fill (lane.real.begin(), lane.real.end(), 0.0f);
+        std::fill (lane.imag.begin(), lane.imag.end(), 0.0f);
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            const auto target = (int) ((float) k * voice.frameRatio + 0.5f);
+
+            if (target >= numBins)
+                break;
+
+            const auto xr = state.spectrumReal[(size_t) k], xi = state.spectrumImag[(size_t) k];
+            const auto sr = link.real[(size_t) k], si = link.imag[(size_t) k];
+            const auto referenceMagnitude = reference.magnitude[(size_t) k];
+
+            // The reference is at least as loud as any one channel, so this only
+            // skips bins where every channel is silent
+            if (referenceMagnitude <= 1.0e-20f)
+                continue;
+
+            const auto scale = weight * (shapeFormants ? getFormantGain (reference, k, target, voice.frameFormantRatio) : 1.0f) / referenceMagnitude;
+
+            lane.real[(size_t) target] += (xr * sr + xi * si) * scale;
+            lane.imag[(size_t) target] += (xi * sr - xr * si) * scale;
+        }
+    }
+
+    // Rotate onto the shared phase
+    PITCHMORPHER_PROFILE_STAGE (profiler, synthesis);
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const auto a = lane.real[(size_t) k], b = lane.imag[(size_t) k];
+        const auto c = link.phaseReal[(size_t) k], d = link.phaseImag[(size_t) k];
+
+        lane.real[(size_t) k] = a * c - b * d;
+        lane.imag[(size_t) k] = a * d + b * c;
+    }
+
+    inverseTransform (lane, state, lane.real.data(), lane.imag.data());
+}
+
+//==============================================================================
+PhaseVocoder::PhaseMode PhaseVocoder::detectTransient (TransientState& transients, const float* magnitude) noexcept
+{
+    // Spectral flux weighted by bin number (high-frequency content), as a share of
+    // the frame's weighted magnitude so it doesn't depend on the level
+    auto* lastMagnitude = transients.lastMagnitude.data();
+    float rise = 0.0f, total = 0.0f;
+
+    for (int k = 1; k < numBins; ++k)
+    {
+        const auto weight = (float) k;
+        rise  += weight * juce::jmax (0.0f, magnitude[k] - lastMagnitude[k]);
+        total += weight * magnitude[k];
+        lastMagnitude[k] = magnitude[k];
+    }
+
+    // Below about -100 dB there is nothing worth protecting
+    const auto isAudible = total > 1.0e-4f * (float) numBins * (float) numBins;
+    const auto flux = isAudible ? rise / total : 0.0f;
+
+    // Only the frame where the flux first jumps counts, so a single attack (which
+    // several overlapping frames see) resets the phases once
+    const auto isOnset = flux > transients.averageFlux + onsetThreshold
+                      && transients.lockedFramesRemaining == 0;
+
+    transients.lastFlux = flux;
+
+    // The average follows the background only, so busy passages don't hide the next hit
+    if (! isOnset && transients.lockedFramesRemaining == 0)
+        transients.averageFlux += 0.1f * (flux - transients.averageFlux);
+
+    if (isOnset)
+    {
+        // Keep the attack coherent while it passes through the following frames
+        transients.lockedFramesRemaining = overlapFactor;
+        return PhaseMode::reset;
+    }
+
+    if (transients.lockedFramesRemaining > 0)
+    {
+        --transients.lockedFramesRemaining;
+        return PhaseMode::locked;
+    }
+
+    return PhaseMode::free;
+}
+
+void PhaseVocoder::applyPhaseMode (PhaseMode mode, Lane& lane, const FrameSpectra& frame, float ratio) noexcept
+{
+    if (mode == PhaseMode::free)
+        return;
+
+    constexpr float silent = 1.0e-20f;
+
+    // The source bin that ended up in each target bin (the last one, as in the remap)
+    std::fill (lane.sourceBin.begin(), lane.sourceBin.end(), -1);
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const auto target = (int) ((float) k * ratio + 0.5f);
+
+        if (target >= numBins)
+            break;
+
+        lane.sourceBin[(size_t) target] = k;
+    }
+
+    // Phases are carried over relative to the centre of the frame rather than its
+    // first sample (a factor of -1 per bin), so a moved bin doesn't also move its
+    // part of the signal in time, and a peak's neighbours keep the phase pattern
+    // of the window's main lobe
+    auto centreSign = [] (int sourceBin, int targetBin)  { return ((sourceBin + targetBin) & 1) != 0 ? -1.0f : 1.0f; };
+
+    if (mode == PhaseMode::reset)
+    {
+        // Start again from the input's own phases: the attack keeps its shape, and
+        // the phase accumulation carries on from there
+        for (int t = 0; t < numBins; ++t)
+        {
+            const auto k = lane.sourceBin[(size_t) t];
+
+            if (k < 0 || frame.magnitude[k] <= silent)
+                continue;
+
+            const auto scale = centreSign (k, t) * frame.synthMagnitude[t] / frame.magnitude[k];
+            frame.outReal[t] = frame.real[k] * scale;
+            frame.outImag[t] = frame.imag[k] * scale;
+            frame.sumPhase[t] = std::atan2 (frame.outImag[t], frame.outReal[t]);
+        }
+
+        return;
+    }
+
+    // Identity phase locking: a peak keeps the phase the vocoder gave it, and the
+    // bins around it keep their analysis phase relative to the peak's. Peaks are
+    // local maxima over two bins either side.
+    auto& nearestPeak = lane.nearestPeak;
+    int lastPeak = -1;
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        const auto m = frame.magnitude[k];
+        auto isPeak = m > silent;
+
+        for (int j = juce::jmax (0, k - 2); j <= juce::jmin (numBins - 1, k + 2) && isPeak; ++j)
+            isPeak = j == k || (j < k ? m > frame.magnitude[j] : m >= frame.magnitude[j]);
+
+        if (isPeak)
+            lastPeak = k;
+
+        nearestPeak[(size_t) k] = lastPeak;
+    }
+
+    // Each bin belongs to whichever peak is closer, looking right as well as left
+    int nextPeak = -1;
+
+    for (int k = numBins; --k >= 0;)
+    {
+        if (nearestPeak[(size_t) k] == k)
+            nextPeak = k;
+        else if (nextPeak >= 0 && (nearestPeak[(size_t) k] < 0 || nextPeak - k < k - nearestPeak[(size_t) k]))
+            nearestPeak[(size_t) k] = nextPeak;
+    }
+
+    // The synthesised phasor of every peak, read before any bin is rewritten. A peak
+    // whose target bin was taken by another source has no anchor (left at zero).
+    for (int k = 0; k < numBins; ++k)
+    {
+        if (nearestPeak[(size_t) k] != k)
+            continue;
+
+        const auto target = (int) ((float) k * ratio + 0.5f);
+        lane.peakReal[(size_t) k] = lane.peakImag[(size_t) k] = 0.0f;
+
+        if (target >= numBins || lane.sourceBin[(size_t) target] != k || frame.synthMagnitude[target] <= silent)
+            continue;
+
+        lane.peakReal[(size_t) k] = frame.outReal[target] / frame.synthMagnitude[target];
+        lane.peakImag[(size_t) k] = frame.outImag[target] / frame.synthMagnitude[target];
+    }
+
+    for (int t = 0; t < numBins; ++t)
+    {
+        const auto k = lane.sourceBin[(size_t) t];
+
+        if (k < 0)
+            continue;
+
+        const auto peak = nearestPeak[(size_t) k];
+
+        if (peak < 0 || peak == k || frame.magnitude[k] <= silent)
+            continue;
+
+        const auto pr = lane.peakReal[(size_t) peak], pi = lane.peakImag[(size_t) peak];
+
+        if (pr == 0.0f && pi == 0.0f)
+            continue;
+
+        // peak phasor * X[k] * conj (X[peak]) / (|X[k]| |X[peak]|)
+        const auto peakTarget = (int) ((float) peak * ratio + 0.5f);
+        const auto norm = centreSign (k - peak, t - peakTarget) / (frame.magnitude[k] * frame.magnitude[peak]);
+        const auto rr = (frame.real[k] * frame.real[peak] + frame.imag[k] * frame.imag[peak]) * norm;
+        const auto ri = (frame.imag[k] * frame.real[peak] - frame.real[k] * frame.imag[peak]) * norm;
+
+        const auto lockedReal = pr * rr - pi * ri;
+        const auto lockedImag = pr * ri + pi * rr;
+
+        frame.outReal[t] = frame.synthMagnitude[t] * lockedReal;
+        frame.outImag[t] = frame.synthMagnitude[t] * lockedImag;
+
+        // So the bin carries on smoothly from here once the locking ends
+        frame.sumPhase[t] = std::atan2 (lockedImag, lockedReal);
+    }
+}
+
+//==============================================================================
+void PhaseVocoder::estimateEnvelope (Lane& lane) noexcept
+{
+    // Log magnitudes on every other bin, lightly smoothed so the decimation doesn't
+    // alias. The spectrum is real and even, so its inverse transform is a real,
+    // symmetric cepstrum.
+    auto& fftData = lane.fftData;
+    const auto& magnitude = lane.magnitude;
+    const int envelopeSize = lane.envelopeFft->getSize();
+
+    for (int j = 0; j < envelopeBins; ++j)
+    {
+        const auto k = 2 * j;
+        const auto below = magnitude[(size_t) juce::jmax (0, k - 1)];
+        const auto above = magnitude[(size_t) juce::jmin (numBins - 1, k + 1)];
+
+        fftData[(size_t) (2 * j)]     = fastLog2 (0.5f * magnitude[(size_t) k] + 0.25f * (below + above) + 1.0e-9f);
+        fftData[(size_t) (2 * j + 1)] = 0.0f;
+    }
+
+    lane.envelopeFft->performRealOnlyInverseTransform (fftData.data());
+
+    // Lifter: the low quefrencies describe the envelope, the rest the harmonics
+    std::fill (fftData.begin() + lifterLength + 1, fftData.begin() + envelopeSize - lifterLength, 0.0f);
+
+    lane.envelopeFft->performRealOnlyForwardTransform (fftData.data(), true);
+
+    for (int j = 0; j < envelopeBins; ++j)
+        lane.logEnvelope[(size_t) j] = fftData[(size_t) (2 * j)];
+}
+
+void PhaseVocoder::trackPitch (Lane& lane, const float* magnitude) noexcept
+{
+    // The frame's autocorrelation is the inverse transform of its power spectrum.
+    // DC is left out, so an offset doesn't read as a very low note.
+    auto& fftData = lane.fftData;
+    float power = 0.0f;
+
+    fftData[0] = fftData[1] = 0.0f;
+
+    for (int k = 1; k < numBins; ++k)
+    {
+        fftData[(size_t) (2 * k)] = magnitude[k] * magnitude[k];
+        fftData[(size_t) (2 * k + 1)] = 0.0f;
+        power += magnitude[k] * magnitude[k];
+    }
+
+    float frequency = 0.0f, clarity = 0.0f;
+
+    // Below about -80 dB there is no note worth correcting
+    if (power > 1.0e-9f * (float) fftSize * (float) fftSize)
+    {
+        lane.fft->performRealOnlyInverseTransform (fftData.data());
+
+        // Normalised so a perfectly periodic frame reads 1 at its period
+        const auto scale = 1.0f / fftData[0];
+
+        for (int lag = 1; lag <= maxPitchLag + 1; ++lag)
+            fftData[(size_t) lag] *= scale * windowCorrelation[(size_t) lag];
+
+        // Skip the lobe around lag 0, then take the first peak within 90% of the
+        // highest, so the octave below (which correlates as well) isn't picked
+        int start = 1;
+
+        while (start <= maxPitchLag && fftData[(size_t) start] > 0.0f)
+            ++start;
+
+        start = juce::jmax (start, minPitchLag);
+
+        float highest = 0.0f;
+
+        for (int lag = start; lag <= maxPitchLag; ++lag)
+            highest = juce::jmax (highest, fftData[(size_t) lag]);
+
+        for (int lag = start; lag <= maxPitchLag && highest >= PitchTracker::clarityThreshold; ++lag)
+        {
+            const auto a = fftData[(size_t) lag - 1], b = fftData[(size_t) lag], c = fftData[(size_t) lag + 1];
+
+            if (b < 0.9f * highest || b < a || b < c)
+                continue;
+
+            const auto curvature = a - 2.0f * b + c;
+            const auto offset = curvature < 0.0f ? 0.5f * (a - c) / curvature : 0.0f;
+
+            frequency = binHz * (float) fftSize / ((float) lag + offset);
+            clarity = juce::jmin (1.0f, b);
+            break;
+        }
+    }
+
+    pitchTracker->addFrame (frequency, clarity, hopSize);
+}
+
+float PhaseVocoder::getFormantGain (const Lane& lane, int sourceBin, int targetBin, float formantRatio) const noexcept
+{
+    // The envelope at the target should be the input envelope warped by the formant
+    // ratio: read it at targetBin / formantRatio and divide out the source's own
+    const auto& logEnvelope = lane.logEnvelope;
+
+    auto readEnvelope = [this, &logEnvelope] (float bin)
+    {
+        const auto position = juce::jmin ((float) (envelopeBins - 1), 0.5f * bin);
+        const auto index = juce::jmin ((int) position, envelopeBins - 2);
+        const auto fraction = position - (float) index;
+
+        return logEnvelope[(size_t) index] + fraction * (logEnvelope[(size_t) index + 1] - logEnvelope[(size_t) index]);
+    };
+
+    const auto warped = readEnvelope ((float) targetBin / formantRatio);
+    const auto original = readEnvelope ((float) sourceBin);
+
+    // Don't pull noise up from deep envelope valleys by more than 24 dB
+    constexpr float maxLog2Gain = 3.9863f; // log2 (10^(24 / 20))
+
+    return fastExp2 (juce::jmin (maxLog2Gain, warped - original));
+}
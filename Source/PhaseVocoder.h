@@ -0,0 +1,301 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "HopScheduler.h"
+#include "PitchTracker.h"
+#include "RealtimeArena.h"
+#include "RealtimeWorkerPool.h"
+#include "SharedTables.h"
+#include "SpectralKernels.h"
+#include "SpectrumFeed.h"
+#include "StageProfiler.h"
+
+//==============================================================================
+/**
+    Streaming FFT phase-vocoder pitch shifter, with formant control, optional
+    harmony voices and pitch correction.
+
+    Each channel's input is collected in a ring buffer and a HopScheduler runs an
+    analysis/resynthesis frame every hop, so the cost per sample and the latency
+    stay constant whatever block sizes the host delivers. All channels share one
+    frame grid, which keeps correlated channels phase-coherent. The per-bin maths
+    runs through the vectorised SpectralKernels, and onsets found by a spectral
+    flux detector reset and phase-lock the synthesis so attacks don't smear.
+
+    The FFT plan is created and every buffer is taken from the RealtimeArena in
+    prepare(); process() never allocates or locks. The window and phase tables
+    come from SharedTables, built once for every vocoder in the process.
+*/
+class PhaseVocoder
+{
+public:
+    //==============================================================================
+    PhaseVocoder() = default;
+
+    /** Which part of the output spectrum to keep. */
+    enum class Band
+    {
+        full,
+        lows,
+        highs
+    };
+
+    /** Sets the frame length at 44.1/48 kHz (a power of two, doubled at higher
+        rates) and how many frames overlap each sample. Overlaps of 4 or more use a
+        Hann window; an overlap of 2 uses a sine window, whose square still sums
+        to a constant at that hop. Call before prepare().
+    */
+    void setResolution (int fftSizeAt48k, int newOverlapFactor) noexcept;
+
+    /** Keeps only the lows or highs of the output, split by a one-octave
+        raised-cosine crossover centred on crossoverHz. The lows and highs of two
+        vocoders of different resolutions sum back to the full band (see
+        MultiResolutionVocoder). Call before prepare().
+    */
+    void setBand (Band newBand, float crossoverHz) noexcept     { band = newBand; crossoverFrequency = crossoverHz; }
+
+    /** Creates the FFT plan, finds the shared tables and takes the ring buffers from the arena.
+        Not realtime-safe.
+    */
+    void prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena);
+
+    /** Clears the ring buffers and phase accumulators of every channel. */
+    void reset() noexcept;
+
+    /** Sets the first voice's frequency ratio (2^(semitones / 12)) to ramp to.
+        The ratio moves on every hop, reaching the new value after pitchRampSeconds.
+    */
+    void setPitchRatio (float newRatio) noexcept        { setVoicePitchRatio (0, newRatio); }
+
+    /** Sets the ratio (2^(semitones / 12)) to move the first voice's spectral
+        envelope by, independently of the pitch. 1 keeps the formants where they were.
+
+        When it differs from the pitch ratio, each channel's envelope is estimated by
+        cepstral liftering of the analysis magnitudes (on a half-length transform),
+        and every moved bin is rescaled to follow the envelope warped by this ratio.
+    */
+    void setFormantRatio (float newRatio) noexcept      { setVoiceFormantRatio (0, newRatio); }
+
+    /** Sets how many voices are shifted from each analysis, from 1 to maxVoices.
+        A voice that comes in starts with fresh phases at its target ratios.
+
+        The input ring, window, forward FFT, transient detection and formant
+        envelope are shared; only the bin remapping and phase synthesis run per
+        voice. The voices are summed (gain and pan applied) in the spectrum, so each
+        channel still needs just one inverse transform.
+    */
+    void setNumVoices (int newNumVoices) noexcept;
+
+    void setVoicePitchRatio (int voice, float newRatio) noexcept       { voices[(size_t) voice].pitchRatio.setTargetValue (newRatio); }
+    void setVoiceFormantRatio (int voice, float newRatio) noexcept     { voices[(size_t) voice].formantRatio.setTargetValue (newRatio); }
+
+    /** Sets a voice's linear gain and its pan from -1 (left) to 1 (right). Pan only
+        applies to stereo, where it fades the opposite side out and leaves the
+        centre at unity. Changes are smoothed by the overlap-add.
+    */
+    void setVoiceMix (int voice, float gain, float pan) noexcept       { voices[(size_t) voice].gain = gain; voices[(size_t) voice].pan = juce::jlimit (-1.0f, 1.0f, pan); }
+
+    int getNumVoices() const noexcept                   { return numVoices; }
+
+    /** Works out the frequencies, formant envelope and synthesis phase once per
+        frame from a reference built from all channels (their sum, with out-of-phase
+        bins flipped so they reinforce). Each channel keeps its own magnitudes and
+        its phase relative to the reference, so the stereo image survives the shift.
+        Takes effect from the next frame. With more than one voice the channels
+        are shifted independently.
+    */
+    void setLinkedChannels (bool shouldLink) noexcept   { linked = shouldLink; }
+
+    /** Lets frames be processed on the pool's threads. Must be called before
+        prepare(), which sizes the scratch for the pool's lanes; nullptr keeps
+        everything on the calling thread. The output doesn't depend on which
+        thread processed which channel.
+    */
+    void setWorkerPool (RealtimeWorkerPool* pool) noexcept  { workers = pool; }
+
+    /** Sends the first channel's spectra to feed from the next frame; nullptr stops it. */
+    void setSpectrumFeed (SpectrumFeed* feed) noexcept  { spectrumFeed = feed; }
+
+    /** Applies tracker's correction to every voice from the next frame; nullptr stops it. */
+    void setPitchTracker (PitchTracker* tracker) noexcept   { pitchTracker = tracker; }
+
+    /** Makes this vocoder the one that detects pitch for the tracker, while it's
+        enabled. The analysis power spectrum (first channel, or the linked
+        reference) is inverse-transformed into the frame's autocorrelation, divided
+        by the window's own, and the first peak near the highest one gives the
+        period (McLeod's key maxima), refined by a parabola. Lags stay below a
+        third of the frame, where the circular wrap-around is small.
+    */
+    void setTracksPitch (bool shouldTrack) noexcept     { tracksPitch = shouldTrack; }
+
+    /** Times the vocoder's stages into profiler (when built with profiling); nullptr stops it. */
+    void setProfiler (StageProfiler* profilerToUse) noexcept    { profiler = profilerToUse; }
+
+    /** Spreads channels over the worker pool from the next frame, when there is one. */
+    void setParallelProcessing (bool shouldRunInParallel) noexcept  { parallel = shouldRunInParallel; }
+
+    /** True while any voice's pitch or formant ratio is still ramping towards its target. */
+    bool isSmoothing() const noexcept;
+
+    /** Shifts the given channels in place. numChannels must not exceed the prepared count. */
+    void process (float* const* channelData, int numChannels, int numSamples) noexcept;
+
+    /** Delay between an input sample and its resynthesised output. */
+    int getLatencyInSamples() const noexcept            { return fftSize; }
+
+    int getFftSize() const noexcept                     { return fftSize; }
+    int getHopSize() const noexcept                     { return hopSize; }
+    int getOverlapFactor() const noexcept               { return overlapFactor; }
+    static constexpr double pitchRampSeconds = 0.05;
+
+    /** Most voices one analysis can feed. */
+    static constexpr int maxVoices = 4;
+
+    /** Quefrencies above this are liftered out of the envelope; it separates
+        formants from harmonics for fundamentals up to about 650 Hz.
+    */
+    static constexpr double lifterSeconds = 0.0015;
+
+    /** A frame is an onset when its weighted flux (the share of the weighted
+        magnitude that is new since the last frame) exceeds the recent average
+        by this much, so vibrato and steady noise don't keep triggering it.
+    */
+    static constexpr float onsetThreshold = 0.3f;
+
+private:
+    //==============================================================================
+    enum class PhaseMode
+    {
+        free,       // every bin accumulates its own phase
+        reset,      // synthesis phases set to the analysis phases (onset)
+        locked      // bins follow the phase of their nearest peak (after an onset)
+    };
+
+    struct TransientState
+    {
+        RealtimeArena::Array<float> lastMagnitude;
+        float lastFlux = 0.0f, averageFlux = 0.0f;
+        int lockedFramesRemaining = 0;
+    };
+
+    struct ChannelState
+    {
+        RealtimeArena::Array<float> inputRing, outputRing;
+        RealtimeArena::Array<float> lastPhase;
+        RealtimeArena::Array<float> sumPhase;                      // paddedBins per voice
+        RealtimeArena::Array<float> spectrumReal, spectrumImag;    // this frame's bins, kept for linked mode
+        TransientState transients;
+    };
+
+    // Analysis and synthesis state of the shared reference in linked mode
+    struct LinkState
+    {
+        RealtimeArena::Array<float> real, imag, lastPhase, sumPhase, phaseReal, phaseImag;
+        TransientState transients;
+    };
+
+    // Everything that only depends on the frame size, overlap and pitch lags,
+    // shared by every vocoder in the process prepared the same way
+    struct Tables  : public SharedTables::Table
+    {
+        RealtimeArena::Array<float> window, expectedPhase, windowCorrelation;
+        float outputGain = 1.0f, windowArea = 1.0f;
+    };
+
+    // Scratch for one thread; frames processed on the same thread share it
+    struct Lane
+    {
+        juce::dsp::FFT* fft = nullptr;
+        juce::dsp::FFT* envelopeFft = nullptr;
+        RealtimeArena::Array<float> fftData;
+        RealtimeArena::Array<float> real, imag, magnitude, frequency, synthMagnitude, synthFrequency;
+        RealtimeArena::Array<float> logEnvelope;    // log2, sampled on every other analysis bin
+        RealtimeArena::Array<float> mixReal, mixImag;   // the voices summed, with more than one
+
+        // Only used on frames around an onset
+        RealtimeArena::Array<float> sourceReal, sourceImag, peakReal, peakImag;
+        RealtimeArena::Array<int> sourceBin, nearestPeak;
+    };
+
+    // The source side of a frame and where its synthesis goes, for applyPhaseMode()
+    struct FrameSpectra
+    {
+        const float* real;
+        const float* imag;
+        const float* magnitude;
+        const float* phase;
+        const float* synthMagnitude;
+        float* sumPhase;
+        float* outReal;
+        float* outImag;
+    };
+
+    // Ramps are in equal steps per semitone; the frame values are those for the current frame
+    struct Voice
+    {
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> pitchRatio { 1.0f }, formantRatio { 1.0f };
+        float frameRatio = 1.0f, frameFormantRatio = 1.0f;
+        float gain = 1.0f, pan = 0.0f;
+    };
+
+    template <typename Function>
+    void forEachChannel (int numChannels, Function&&) noexcept;
+
+    void forwardTransform (Lane&, const ChannelState&, float* realOut, float* imagOut) noexcept;
+    void inverseTransform (Lane&, ChannelState&, const float* realIn, const float* imagIn) noexcept;
+    void processFrame (Lane&, int channel) noexcept;
+    void remapVoice (Lane&, const Voice&) noexcept;
+    void analyseLinkedFrame (int numChannels) noexcept;
+    void synthesiseLinkedFrame (Lane&, int channel) noexcept;
+    PhaseMode detectTransient (TransientState&, const float* magnitude) noexcept;
+    void applyPhaseMode (PhaseMode, Lane&, const FrameSpectra&, float ratio) noexcept;
+    void estimateEnvelope (Lane&) noexcept;
+    void trackPitch (Lane&, const float* magnitude) noexcept;
+    float getFormantGain (const Lane&, int sourceBin, int targetBin, float formantRatio) const noexcept;
+    float getVoiceWeight (int voice, int channel) const noexcept;
+    int getFftOrderForSampleRate (double sampleRate) const noexcept;
+    void buildTables (Tables&, int fftOrder) const;
+
+    //==============================================================================
+    std::vector<std::unique_ptr<juce::dsp::FFT>> fftPlans;
+    const SpectralKernels::KernelTable* kernels = nullptr;
+    int baseFftOrder = 11, overlapFactor = 4;
+    int fftSize = 0, hopSize = 0, numBins = 0, paddedBins = 0;
+    float outputGain = 1.0f;
+
+    // Scales bins so a full-scale sine reads 1, for the spectrum display
+    float displayGain = 1.0f, binHz = 1.0f;
+    SpectrumFeed* spectrumFeed = nullptr;
+    StageProfiler* profiler = nullptr;
+    SpectrumFeed::Frame* displayFrame = nullptr;   // set for frames the feed asked for
+
+    // Pitch detection: 1 / the window's normalised autocorrelation at each lag up to maxPitchLag
+    PitchTracker* pitchTracker = nullptr;
+    bool tracksPitch = false;
+    RealtimeArena::Array<float> windowCorrelation;
+    int minPitchLag = 1, maxPitchLag = 1;
+
+    Band band = Band::full;
+    float crossoverFrequency = 1000.0f;
+    RealtimeArena::Array<float> bandWeight;     // empty for the full band
+
+    std::array<Voice, maxVoices> voices;
+    int numVoices = 1, numFrameChannels = 0;
+    int lifterLength = 0, envelopeBins = 0;
+
+    // Views of the shared tables, which stay alive as long as this holds them
+    std::shared_ptr<const Tables> tables;
+    RealtimeArena::Array<float> window, expectedPhase;
+    RealtimeArena::Array<Lane> lanes;
+
+    RealtimeArena::Array<ChannelState> channels;
+    LinkState link;
+    bool linked = false;
+
+    RealtimeWorkerPool* workers = nullptr;
+    bool parallel = false;
+    HopScheduler scheduler;
+    int ringPosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PhaseVocoder)
+};
@@ -0,0 +1,474 @@
+#include "PitchShiftEngine.h"
+
+namespace
+{
+    struct Resolution
+    {
+        int fftSize, overlap;
+    };
+
+    // The fixed-resolution tiers, in the order of PitchShiftEngine::Quality
+    constexpr Resolution tierResolutions[] = { { 512, 2 }, { 1024, 4 }, { 2048, 4 }, { 4096, 8 }, { 8192, 8 } };
+
+    constexpr Resolution multiResolutionLows { 4096, 8 }, multiResolutionHighs { 1024, 4 };
+}
+
+//==============================================================================
+PitchShiftEngine::PitchShiftEngine()
+{
+    static_assert ((int) std::size (tierResolutions) == numFixedTiers, "One resolution per fixed tier");
+
+    for (size_t i = 0; i < vocoders.size(); ++i)
+        vocoders[i].setResolution (tierResolutions[i].fftSize, tierResolutions[i].overlap);
+
+    multiResolution.setResolutions (multiResolutionLows.fftSize, multiResolutionLows.overlap,
+                                    multiResolutionHighs.fftSize, multiResolutionHighs.overlap,
+                                    multiResolutionCrossoverHz);
+}
+
+template <typename Function>
+void PitchShiftEngine::forEachVocoder (Function&& function)
+{
+    for (auto& vocoder : vocoders)
+        function (vocoder);
+
+    function (multiResolution);
+}
+
+void PitchShiftEngine::prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena)
+{
+    // Every tier is prepared, so switching only ever resets one
+    forEachVocoder ([&] (auto& vocoder) { vocoder.prepare (spec, arena); });
+    wsola.prepare (spec, arena);
+
+    maxBlockSize = juce::jmax (1, (int) spec.maximumBlockSize);
+
+    // The bypass delay stands in for whichever engine is selected, so it must
+    // reach the longest of them
+    int maxLatency = 0;
+    for (int engine = 0; engine < bypassEngine; ++engine)
+        maxLatency = juce::jmax (maxLatency, getLatencyInSamples (engine));
+
+    bypassDelay.prepare ((int) spec.numChannels, maxLatency, maxBlockSize, arena);
+    dryDelay.prepare ((int) spec.numChannels, maxLatency, maxBlockSize, arena);
+
+    incomingChannels = arena.allocate<float*> (spec.numChannels);
+    chunkChannels = arena.allocate<float*> (spec.numChannels);
+    chunkDryChannels = arena.allocate<float*> (spec.numChannels);
+
+    for (auto& channel : incomingChannels)
+        channel = arena.allocate<float> ((size_t) maxBlockSize).data();
+
+    outgoingGains = arena.allocate<float> ((size_t) maxBlockSize);
+    incomingGains = arena.allocate<float> ((size_t) maxBlockSize);
+
+    fadeLength = juce::jmax (1, juce::roundToInt (spec.sampleRate * crossfadeSeconds));
+
+    reset();
+}
+
+void PitchShiftEngine::reset() noexcept
+{
+    forEachVocoder ([] (auto& vocoder) { vocoder.reset(); });
+    wsola.reset();
+    resetEngine (bypassEngine);
+    dryDelay.reset();
+
+    setActiveEngine (targetEngine);
+    primeRemaining = fadePosition = 0;
+    silentSamples = 0;
+    isIdle = false;
+}
+
+void PitchShiftEngine::setPitchRatio (float newRatio) noexcept
+{
+    forEachVocoder ([newRatio] (auto& vocoder) { vocoder.setPitchRatio (newRatio); });
+    wsola.setPitchRatio (newRatio);
+}
+
+void PitchShiftEngine::setFormantRatio (float newRatio) noexcept
+{
+    forEachVocoder ([newRatio] (auto& vocoder) { vocoder.setFormantRatio (newRatio); });
+}
+
+void PitchShiftEngine::setNumVoices (int newNumVoices) noexcept
+{
+    forEachVocoder ([newNumVoices] (auto& vocoder) { vocoder.setNumVoices (newNumVoices); });
+}
+
+void PitchShiftEngine::setVoiceRatios (int voice, float pitchRatio, float formantRatio) noexcept
+{
+    jassert (voice >= 0 && voice < PhaseVocoder::maxVoices);
+
+    forEachVocoder ([=] (auto& vocoder)
+    {
+        vocoder.setVoicePitchRatio (voice, pitchRatio);
+        vocoder.setVoiceFormantRatio (voice, formantRatio);
+    });
+
+    if (voice == 0)
+        wsola.setPitchRatio (pitchRatio);
+}
+
+void PitchShiftEngine::setVoiceMix (int voice, float gain, float pan) noexcept
+{
+    jassert (voice >= 0 && voice < PhaseVocoder::maxVoices);
+    forEachVocoder ([=] (auto& vocoder) { vocoder.setVoiceMix (voice, gain, pan); });
+}
+
+void PitchShiftEngine::setLinkedChannels (bool shouldLink) noexcept
+{
+    forEachVocoder ([shouldLink] (auto& vocoder) { vocoder.setLinkedChannels (shouldLink); });
+}
+
+void PitchShiftEngine::setWorkerPool (RealtimeWorkerPool* pool) noexcept
+{
+    forEachVocoder ([pool] (auto& vocoder) { vocoder.setWorkerPool (pool); });
+}
+
+void PitchShiftEngine::setParallelProcessing (bool shouldRunInParallel) noexcept
+{
+    forEachVocoder ([shouldRunInParallel] (auto& vocoder) { vocoder.setParallelProcessing (shouldRunInParallel); });
+}
+
+void PitchShiftEngine::setProfiler (StageProfiler* profilerToUse) noexcept
+{
+    profiler = profilerToUse;
+    forEachVocoder ([profilerToUse] (auto& vocoder) { vocoder.setProfiler (profilerToUse); });
+}
+
+void PitchShiftEngine::setSpectrumFeed (SpectrumFeed* feed) noexcept
+{
+    spectrumFeed = feed;
+    setActiveEngine (activeEngine);
+}
+
+void PitchShiftEngine::setPitchTracker (PitchTracker* tracker) noexcept
+{
+    pitchTracker = tracker;
+    forEachVocoder ([tracker] (auto& vocoder) { vocoder.setPitchTracker (tracker); });
+    setActiveEngine (activeEngine);
+}
+
+void PitchShiftEngine::setActiveEngine (int engine) noexcept
+{
+    activeEngine = engine;
+
+    // Only the audible vocoder feeds the display and detects pitch
+    for (size_t i = 0; i < vocoders.size(); ++i)
+    {
+        vocoders[i].setSpectrumFeed ((int) i == activeEngine ? spectrumFeed : nullptr);
+        vocoders[i].setTracksPitch ((int) i == activeEngine);
+    }
+
+    multiResolution.setSpectrumFeed (activeEngine == multiResolutionEngine ? spectrumFeed : nullptr);
+    multiResolution.setTracksPitch (activeEngine == multiResolutionEngine);
+
+    // With nothing left to detect from, a correction would be stuck where it was
+    if (pitchTracker != nullptr && activeEngine >= wsolaEngine)
+        pitchTracker->reset();
+}
+
+bool PitchShiftEngine::isSmoothing() const noexcept
+{
+    if (activeEngine == bypassEngine)
+        return false;
+
+    if (activeEngine == wsolaEngine)
+        return wsola.isSmoothing();
+
+    if (activeEngine == multiResolutionEngine)
+        return multiResolution.isSmoothing();
+
+    return vocoders[(size_t) activeEngine].isSmoothing();
+}
+
+//==============================================================================
+int PitchShiftEngine::getEngineFor (Mode newMode, Quality newQuality, bool isBypassed) const noexcept
+{
+    if (isBypassed)
+        return bypassEngine;
+
+    if (newMode == Mode::lowLatency)
+        return wsolaEngine;
+
+    return newQuality == Quality::multiResolution ? multiResolutionEngine : (int) newQuality;
+}
+
+void PitchShiftEngine::setMode (Mode newMode) noexcept
+{
+    mode = newMode;
+    updateTarget();
+}
+
+void PitchShiftEngine::setQuality (Quality newQuality) noexcept
+{
+    quality = newQuality;
+    updateTarget();
+}
+
+void PitchShiftEngine::setBypassed (bool shouldBeBypassed) noexcept
+{
+    bypassed = shouldBeBypassed;
+    updateTarget();
+}
+
+void PitchShiftEngine::updateTarget() noexcept
+{
+    switchTo (getEngineFor (mode, quality, bypassed));
+
+    // The bypass delay has to follow the latency of the engine it stands in for
+    const auto latency = getLatencyInSamples (bypassEngine);
+
+    if (targetEngine != bypassEngine || bypassDelay.getDelay() == latency)
+        return;
+
+    if (activeEngine == bypassEngine)
+    {
+        bypassDelay.setDelay (latency);
+    }
+    else
+    {
+        // Still coming in: prime again at the new length
+        resetEngine (bypassEngine);
+        primeRemaining = latency;
+        fadePosition = 0;
+    }
+}
+
+void PitchShiftEngine::switchTo (int newEngine) noexcept
+{
+    if (newEngine == targetEngine)
+        return;
+
+    if (activeEngine == targetEngine)
+    {
+        // Start a new switch: the incoming engine must fill up before it's audible
+        targetEngine = newEngine;
+        resetEngine (targetEngine);
+
+        primeRemaining = getLatencyInSamples (targetEngine);
+        fadePosition = 0;
+    }
+    else if (newEngine == activeEngine && primeRemaining > 0)
+    {
+        // Switched back before the fade began: just keep the engine we had
+        targetEngine = activeEngine;
+    }
+    else if (newEngine == activeEngine)
+    {
+        // Switched back mid-fade: both engines are primed, so run the fade in reverse
+        const auto outgoing = activeEngine;
+        setActiveEngine (targetEngine);
+        targetEngine = outgoing;
+        fadePosition = fadeLength - fadePosition;
+    }
+    else
+    {
+        // A third engine while switching: it replaces the incoming one and primes
+        // from scratch, while the outgoing engine keeps playing
+        targetEngine = newEngine;
+        resetEngine (targetEngine);
+
+        primeRemaining = getLatencyInSamples (targetEngine);
+        fadePosition = 0;
+    }
+}
+
+void PitchShiftEngine::resetEngine (int engine) noexcept
+{
+    if (engine == bypassEngine)
+    {
+        bypassDelay.reset();
+        bypassDelay.setDelay (getLatencyInSamples (bypassEngine));
+    }
+    else if (engine == wsolaEngine)
+        wsola.reset();
+    else if (engine == multiResolutionEngine)
+        multiResolution.reset();
+    else
+        vocoders[(size_t) engine].reset();
+}
+
+int PitchShiftEngine::getLatencyInSamples (int engine) const noexcept
+{
+    if (engine == bypassEngine)
+        return getLatencyInSamples (getEngineFor (mode, quality, false));
+
+    if (engine == wsolaEngine)
+        return wsola.getLatencyInSamples();
+
+    if (engine == multiResolutionEngine)
+        return multiResolution.getLatencyInSamples();
+
+    return vocoders[(size_t) engine].getLatencyInSamples();
+}
+
+int PitchShiftEngine::getAudibleLatency (int engine) const noexcept
+{
+    // A bypass that's fading out keeps its delay even if the engine it stood in
+    // for has changed since
+    return engine == bypassEngine ? bypassDelay.getDelay() : getLatencyInSamples (engine);
+}
+
+void PitchShiftEngine::processWith (int engine, float* const* channelData, int numChannels, int numSamples) noexcept
+{
+    if (engine == bypassEngine)
+        bypassDelay.process (channelData, numChannels, numSamples);
+    else if (engine == wsolaEngine)
+    {
+        PITCHMORPHER_PROFILE_STAGE (profiler, wsola);
+        wsola.process (channelData, numChannels, numSamples);
+    }
+    else if (engine == multiResolutionEngine)
+        multiResolution.process (channelData, numChannels, numSamples);
+    else
+        vocoders[(size_t) engine].process (channelData, numChannels, numSamples);
+}
+
+//==============================================================================
+bool PitchShiftEngine::skipSilence (float* const* channelData, int numChannels, int numSamples) noexcept
+{
+    auto isSilent = true;
+
+    for (int ch = 0; ch < numChannels && isSilent; ++ch)
+    {
+        const auto range = juce::FloatVectorOperations::findMinAndMax (channelData[ch], numSamples);
+        isSilent = range.getStart() >= -silenceThreshold && range.getEnd() <= silenceThreshold;
+    }
+
+    silentSamples = isSilent ? (int) juce::jmin ((juce::int64) silentSamples + numSamples, (juce::int64) std::numeric_limits<int>::max())
+                             : 0;
+
+    // Every engine's output depends on no more than twice its latency of input,
+    // so once that much (before this block) is silent, so is this block's output
+    const auto canSkip = isSilent
+                      && activeEngine == targetEngine
+                      && silentSamples >= 2 * getAudibleLatency (activeEngine) + numSamples;
+
+    if (! canSkip)
+    {
+        // Coming back from idle: flush what's left of the engine's state
+        if (isIdle)
+        {
+            resetEngine (activeEngine);
+            isIdle = false;
+        }
+
+        return false;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::clear (channelData[ch], numSamples);
+
+    isIdle = true;
+    return true;
+}
+
+void PitchShiftEngine::process (float* const* channelData, int numChannels, int numSamples, float* const* dryData) noexcept
+{
+    if (numSamples <= maxBlockSize)
+    {
+        processChunk (channelData, dryData, numChannels, numSamples);
+        return;
+    }
+
+    jassert (numChannels <= (int) chunkChannels.size());
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numThisTime = juce::jmin (numSamples - done, maxBlockSize);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            chunkChannels[(size_t) ch] = channelData[ch] + done;
+
+            if (dryData != nullptr)
+                chunkDryChannels[(size_t) ch] = dryData[ch] + done;
+        }
+
+        processChunk (chunkChannels.data(), dryData != nullptr ? chunkDryChannels.data() : nullptr, numChannels, numThisTime);
+        done += numThisTime;
+    }
+}
+
+void PitchShiftEngine::processChunk (float* const* channelData, float* const* dryData, int numChannels, int numSamples) noexcept
+{
+    // The dry signal is always recorded, so it's there the moment a mix needs it
+    dryDelay.write (channelData, numChannels, numSamples);
+
+    const auto isSkipped = skipSilence (channelData, numChannels, numSamples);
+
+    if (activeEngine == targetEngine)
+    {
+        if (! isSkipped)
+            processWith (activeEngine, channelData, numChannels, numSamples);
+
+        if (dryData != nullptr)
+            dryDelay.read (dryData, numChannels, numSamples, getAudibleLatency (activeEngine));
+
+        return;
+    }
+
+    jassert (numChannels <= (int) incomingChannels.size());
+
+    // Run the incoming engine on a copy of the input, the outgoing one in place
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::copy (incomingChannels[(size_t) ch], channelData[ch], numSamples);
+
+    processWith (targetEngine, incomingChannels.data(), numChannels, numSamples);
+    processWith (activeEngine, channelData, numChannels, numSamples);
+
+    // Gains for the whole chunk: the outgoing engine alone while the incoming one
+    // primes, then a fade, then the incoming engine alone. The bypass delay lines
+    // up with an engine of the same latency, and at unity the two nearly match,
+    // so that fade is linear; any other pair is offset in time and starts from
+    // fresh phases, so it's uncorrelated and gets an equal-power fade
+    const int numPriming = juce::jmin (numSamples, primeRemaining);
+    primeRemaining -= numPriming;
+
+    const auto isLinear = (activeEngine == bypassEngine || targetEngine == bypassEngine)
+                       && getAudibleLatency (activeEngine) == getAudibleLatency (targetEngine);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (i >= numPriming && fadePosition < fadeLength)
+            ++fadePosition;
+
+        const auto fadeIn = (float) (i < numPriming ? 0 : fadePosition) / (float) fadeLength;
+
+        if (isLinear)
+        {
+            outgoingGains[(size_t) i] = 1.0f - fadeIn;
+            incomingGains[(size_t) i] = fadeIn;
+        }
+        else
+        {
+            const auto angle = juce::MathConstants<float>::halfPi * fadeIn;
+            outgoingGains[(size_t) i] = std::cos (angle);
+            incomingGains[(size_t) i] = std::sin (angle);
+        }
+    }
+
+    crossfade (channelData, incomingChannels.data(), numChannels, numSamples);
+
+    // The dry signal follows the same fade between the two engines' latencies
+    if (dryData != nullptr)
+    {
+        dryDelay.read (dryData, numChannels, numSamples, getAudibleLatency (activeEngine));
+        dryDelay.read (incomingChannels.data(), numChannels, numSamples, getAudibleLatency (targetEngine));
+        crossfade (dryData, incomingChannels.data(), numChannels, numSamples);
+    }
+
+    if (fadePosition >= fadeLength)
+        setActiveEngine (targetEngine);
+}
+
+void PitchShiftEngine::crossfade (float* const* outgoing, const float* const* incoming, int numChannels, int numSamples) const noexcept
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        juce::FloatVectorOperations::multiply (outgoing[ch], outgoingGains.data(), numSamples);
+        juce::FloatVectorOperations::addWithMultiply (outgoing[ch], incoming[ch], incomingGains.data(), numSamples);
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MultiResolutionVocoder.h"
+#include "MultichannelDelay.h"
+#include "PhaseVocoder.h"
+#include "WsolaShifter.h"
+
+//==============================================================================
+/**
+    Owns both pitch-shifting engines and switches between them.
+
+    The high-quality mode runs a PhaseVocoder, the low-latency mode the
+    WsolaShifter. The high-quality mode comes in several quality tiers, each a
+    vocoder with its own frame length and overlap (or, for the multi-resolution
+    tier, a MultiResolutionVocoder), and every tier is prepared up front so
+    switching never allocates.
+
+    On a change of mode or tier the incoming engine is reset and run alongside
+    the outgoing one until its own latency has elapsed, then the two are
+    crossfaded: equal-power between engines, linearly to and from the bypass
+    delay. Everything happens on the audio thread using buffers
+    taken from the RealtimeArena in prepare().
+
+    Two idle states keep parked instances cheap without changing the latency:
+
+    - Bypassed (see setBypassed()) swaps the shifter for a plain delay of the
+      same latency, through the same primed crossfade, and back again.
+    - Once the input has been digitally silent for longer than the active
+      engine's memory, its output is silent too, so it stops being run. The
+      first block with signal in it flushes the engine and carries on; what
+      comes out is what it would have produced from all that silence.
+*/
+class PitchShiftEngine
+{
+public:
+    //==============================================================================
+    enum class Mode
+    {
+        highQuality,
+        lowLatency
+    };
+
+    /** Frame length and overlap of the high-quality mode; sizes are at 44.1/48 kHz
+        and double at higher rates.
+    */
+    enum class Quality
+    {
+        draft,              // 512 points, 2x overlap
+        low,                // 1024 points, 4x overlap
+        standard,           // 2048 points, 4x overlap
+        high,               // 4096 points, 8x overlap
+        ultra,              // 8192 points, 8x overlap
+        multiResolution     // 4096 points, 8x overlap below the crossover, 1024 points, 4x overlap above
+    };
+
+    static constexpr int numQualities = 6;
+
+    PitchShiftEngine();
+
+    /** Prepares every engine and quality tier from the arena. The mode and tier
+        last passed to setMode() and setQuality() become active straight away,
+        without a crossfade.
+    */
+    void prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena);
+
+    /** Clears the state of both engines. */
+    void reset() noexcept;
+
+    /** Selects the engine; changing it while playing starts a crossfade. */
+    void setMode (Mode newMode) noexcept;
+
+    /** Selects the high-quality mode's tier; changing it while that mode is
+        playing starts a crossfade.
+    */
+    void setQuality (Quality newQuality) noexcept;
+
+    /** Sets the frequency ratio both engines ramp to, hop by hop. Once a ramp has
+        finished it costs nothing.
+    */
+    void setPitchRatio (float newRatio) noexcept;
+
+    /** Sets the formant ratio the phase vocoder ramps to. The low-latency engine
+        works in the time domain and can't separate formants, so there they
+        follow the pitch.
+    */
+    void setFormantRatio (float newRatio) noexcept;
+
+    /** Sets how many harmony voices the phase vocoder shifts from its one analysis
+        (see PhaseVocoder::setNumVoices()). Voice 0 is the one setPitchRatio() and
+        setFormantRatio() control. The low-latency engine only plays voice 0, at
+        unity gain and centred.
+    */
+    void setNumVoices (int newNumVoices) noexcept;
+
+    /** Sets the pitch and formant ratios a harmony voice ramps to; for voice 0 this
+        is the same as setPitchRatio() and setFormantRatio().
+    */
+    void setVoiceRatios (int voice, float pitchRatio, float formantRatio) noexcept;
+
+    /** Sets a harmony voice's linear gain and pan (-1 to 1, stereo only). */
+    void setVoiceMix (int voice, float gain, float pan) noexcept;
+
+    /** Makes the phase vocoder take one set of phase decisions for all channels
+        (see PhaseVocoder). The low-latency engine always picks a single splice
+        point from the sum of its channels, so it is linked either way.
+    */
+    void setLinkedChannels (bool shouldLink) noexcept;
+
+    /** Gives the phase vocoder a pool to spread channels over; call before
+        prepare(). WSOLA's per-channel work is too light to be worth handing off.
+    */
+    void setWorkerPool (RealtimeWorkerPool* pool) noexcept;
+
+    /** Turns use of the worker pool on or off; the output is the same either way. */
+    void setParallelProcessing (bool shouldRunInParallel) noexcept;
+
+    /** Shows the spectra of the audible phase vocoder in feed. The feed moves to
+        the incoming vocoder once a switch has finished, and the low-latency
+        engine has no spectra to show.
+    */
+    void setSpectrumFeed (SpectrumFeed* feed) noexcept;
+
+    /** Corrects every vocoder's pitch by tracker, and lets the audible one detect
+        pitch for it (see PhaseVocoder::setPitchTracker()). The low-latency engine
+        has no analysis to detect from, so it plays uncorrected and the
+        correction is dropped while it's active.
+    */
+    void setPitchTracker (PitchTracker* tracker) noexcept;
+
+    /** Times every engine's stages into profiler; see StageProfiler. */
+    void setProfiler (StageProfiler* profilerToUse) noexcept;
+
+    /** Swaps the shifter for a delay of the same latency, for settings that
+        wouldn't change the sound. Changing it while playing starts a crossfade,
+        and the latency stays the same.
+    */
+    void setBypassed (bool shouldBeBypassed) noexcept;
+
+    /** True while the active engine is still ramping its pitch ratio. */
+    bool isSmoothing() const noexcept;
+
+    /** Shifts the given channels in place. If dryData isn't null, it receives the
+        input delayed to line up with the output: by the audible engine's latency,
+        crossfaded along with the engines while switching.
+    */
+    void process (float* const* channelData, int numChannels, int numSamples, float* const* dryData = nullptr) noexcept;
+
+    /** Latency of the engine being switched to, i.e. what the host should
+        compensate. Bypassing doesn't change it.
+    */
+    int getLatencyInSamples() const noexcept            { return getLatencyInSamples (targetEngine); }
+
+    static constexpr double crossfadeSeconds = 0.02;
+
+    /** Peak level below which a block counts as digital silence (-120 dBFS). */
+    static constexpr float silenceThreshold = 1.0e-6f;
+
+    /** Where the multi-resolution tier splits its long and short frames. */
+    static constexpr float multiResolutionCrossoverHz = 700.0f;
+
+private:
+    //==============================================================================
+    // Engines are numbered: one per fixed-resolution tier, then the
+    // multi-resolution vocoder, WSOLA and the bypass delay
+    static constexpr int numFixedTiers = numQualities - 1;
+    static constexpr int multiResolutionEngine = numFixedTiers;
+    static constexpr int wsolaEngine = multiResolutionEngine + 1;
+    static constexpr int bypassEngine = wsolaEngine + 1;
+
+    template <typename Function>
+    void forEachVocoder (Function&&);
+
+    int getEngineFor (Mode, Quality, bool bypassed) const noexcept;
+    void updateTarget() noexcept;
+    bool skipSilence (float* const* channelData, int numChannels, int numSamples) noexcept;
+    void switchTo (int newEngine) noexcept;
+    void setActiveEngine (int engine) noexcept;
+    void resetEngine (int engine) noexcept;
+    int getLatencyInSamples (int engine) const noexcept;
+    int getAudibleLatency (int engine) const noexcept;
+    void processChunk (float* const* channelData, float* const* dryData, int numChannels, int numSamples) noexcept;
+    void crossfade (float* const* outgoing, const float* const* incoming, int numChannels, int numSamples) const noexcept;
+    void processWith (int engine, float* const* channelData, int numChannels, int numSamples) noexcept;
+
+    std::array<PhaseVocoder, numFixedTiers> vocoders;
+    MultiResolutionVocoder multiResolution;
+    WsolaShifter wsola;
+    MultichannelDelay bypassDelay, dryDelay;
+
+    Mode mode = Mode::highQuality;
+    Quality quality = Quality::standard;
+    bool bypassed = false;
+    int activeEngine = (int) Quality::standard, targetEngine = (int) Quality::standard;
+    SpectrumFeed* spectrumFeed = nullptr;
+    PitchTracker* pitchTracker = nullptr;
+    StageProfiler* profiler = nullptr;
+
+    // The incoming engine's copy of the input while switching, the fade's gains,
+    // and views into blocks longer than the prepared size
+    RealtimeArena::Array<float*> incomingChannels, chunkChannels, chunkDryChannels;
+    RealtimeArena::Array<float> outgoingGains, incomingGains;
+    int maxBlockSize = 0;
+    int primeRemaining = 0, fadePosition = 0, fadeLength = 1;
+
+    // Consecutive silent input samples, and whether the active engine has been
+    // left out since
+    int silentSamples = 0;
+    bool isIdle = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchShiftEngine)
+};
@@ -0,0 +1,146 @@
+#include "PitchTracker.h"
+
+namespace
+{
+    // Pitch classes of each scale from its root, one bit per semitone
+    constexpr juce::uint32 scaleMasks[] =
+    {
+        0xfff,                                                                  // chromatic
+        (1u << 0) | (1u << 2) | (1u << 4) | (1u << 5) | (1u << 7) | (1u << 9) | (1u << 11),   // major
+        (1u << 0) | (1u << 2) | (1u << 3) | (1u << 5) | (1u << 7) | (1u << 8) | (1u << 10),   // natural minor
+        (1u << 0) | (1u << 2) | (1u << 3) | (1u << 5) | (1u << 7) | (1u << 8) | (1u << 11),   // harmonic minor
+        (1u << 0) | (1u << 2) | (1u << 4) | (1u << 7) | (1u << 9),                            // major pentatonic
+        (1u << 0) | (1u << 3) | (1u << 5) | (1u << 7) | (1u << 10)                            // minor pentatonic
+    };
+
+    static_assert (std::size (scaleMasks) == (size_t) PitchTracker::numScales, "One mask per scale");
+
+    bool isInScale (int note, int key, PitchTracker::Scale scale) noexcept
+    {
+        const auto pitchClass = (((note - key) % 12) + 12) % 12;
+        return (scaleMasks[(size_t) scale] & (1u << pitchClass)) != 0;
+    }
+}
+
+//==============================================================================
+void PitchTracker::prepare (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void PitchTracker::reset() noexcept
+{
+    targetNote = -1;
+    targetCorrection = correction = 0.0f;
+    correctionRatio = 1.0f;
+}
+
+void PitchTracker::setEnabled (bool shouldBeEnabled) noexcept
+{
+    if (shouldBeEnabled != enabled)
+        reset();
+
+    enabled = shouldBeEnabled;
+}
+
+int PitchTracker::snapToScale (float note, int key, Scale scale) noexcept
+{
+    // Every scale has a note within six semitones either way
+    const auto nearest = juce::roundToInt (note);
+    auto best = nearest;
+    auto bestDistance = std::numeric_limits<float>::max();
+
+    for (int candidate = nearest - 6; candidate <= nearest + 6; ++candidate)
+    {
+        const auto distance = std::abs (note - (float) candidate);
+
+        if (distance < bestDistance && isInScale (candidate, key, scale))
+        {
+            best = candidate;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+//==============================================================================
+void PitchTracker::addFrame (float frequency, float clarity, int numSamplesAdvanced) noexcept
+{
+    if (! enabled)
+        return;
+
+    if (frequency > 0.0f)
+    {
+        const auto note = 69.0f + 12.0f * std::log2 (frequency / 440.0f);
+        const auto snapped = snapToScale (note, key, scale);
+
+        // Stay on the current note until the input is clearly nearer another one
+        const auto keepTarget = targetNote >= 0
+                             && isInScale (targetNote, key, scale)
+                             && std::abs (note - (float) targetNote) < std::abs (note - (float) snapped) + hysteresisSemitones;
+
+        if (! keepTarget)
+            targetNote = snapped;
+
+        targetCorrection = (float) targetNote - note;
+    }
+
+    const auto seconds = (double) numSamplesAdvanced / sampleRate;
+    const auto step = retuneSeconds > 0.0f ? (float) (1.0 - std::exp (-seconds / retuneSeconds)) : 1.0f;
+
+    correction += step * (targetCorrection - correction);
+    correctionRatio = std::exp2 (correction / 12.0f);
+
+    if (numViewers.load (std::memory_order_relaxed) > 0)
+        publish (frequency, clarity);
+}
+
+void PitchTracker::publish (float frequency, float clarity) noexcept
+{
+    const auto start = sequence.load (std::memory_order_relaxed);
+
+    sequence.store (start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    publishedFrequency.store (frequency, std::memory_order_relaxed);
+    publishedClarity.store (clarity, std::memory_order_relaxed);
+    publishedTarget.store ((float) targetNote, std::memory_order_relaxed);
+    publishedCorrection.store (correction, std::memory_order_relaxed);
+
+    sequence.store (start + 2, std::memory_order_release);
+}
+
+bool PitchTracker::readLatest (Reading& destination) noexcept
+{
+    // A write landing in the middle of the copy changes the sequence; try again,
+    // and leave it for the next call if the audio side keeps getting in the way
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        const auto before = sequence.load (std::memory_order_acquire);
+
+        if (before == lastReadSequence)
+            return false;
+
+        if ((before & 1) != 0)
+            continue;
+
+        Reading reading;
+        reading.frequency = publishedFrequency.load (std::memory_order_relaxed);
+        reading.clarity = publishedClarity.load (std::memory_order_relaxed);
+        reading.targetNote = publishedTarget.load (std::memory_order_relaxed);
+        reading.correction = publishedCorrection.load (std::memory_order_relaxed);
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        if (sequence.load (std::memory_order_relaxed) == before)
+        {
+            destination = reading;
+            lastReadSequence = before;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Turns the fundamental frequencies the phase vocoder detects into a pitch
+    correction, and hands what it heard to the editor.
+
+    The detection itself runs inside the vocoder, on the analysis it already
+    made (see PhaseVocoder::setPitchTracker()); every frame it reports a
+    frequency and how clearly periodic the frame was. Voiced frames are snapped
+    to the nearest note of the selected key and scale, and the correction (the
+    snapped note minus the detected one, in semitones) glides towards that with
+    the retune time, so 0 snaps hard and longer times let vibrato and slides
+    through. Unvoiced frames keep the last correction, so consonants don't
+    bounce. Every vocoder multiplies its pitch ratios by the correction on each
+    frame, on top of the pitch shift.
+
+    The editor reads the latest frame's values through a sequence lock of
+    atomics: the audio side never waits, and the editor retries a read that
+    overlapped a write. As with SpectrumFeed, nothing is published while no
+    viewer is attached.
+*/
+class PitchTracker
+{
+public:
+    //==============================================================================
+    enum class Scale
+    {
+        chromatic,
+        major,
+        naturalMinor,
+        harmonicMinor,
+        majorPentatonic,
+        minorPentatonic
+    };
+
+    static constexpr int numScales = 6;
+
+    /** Range of fundamentals the detector looks for. Short frames can't hold two
+        periods of the lowest ones, so the shortest quality tiers start higher.
+    */
+    static constexpr float minFrequency = 60.0f, maxFrequency = 1200.0f;
+
+    /** Normalised autocorrelation peak a frame needs to count as pitched. */
+    static constexpr float clarityThreshold = 0.85f;
+
+    /** How far past the midpoint between two notes the input has to go before the
+        target moves, so a note sung between them doesn't flip back and forth.
+    */
+    static constexpr float hysteresisSemitones = 0.15f;
+
+    /** The last frame, for display. frequency is 0 for unpitched frames. */
+    struct Reading
+    {
+        float frequency = 0.0f, clarity = 0.0f;
+        float targetNote = 0.0f;        // MIDI note the correction is heading for
+        float correction = 0.0f;        // semitones currently applied
+    };
+
+    PitchTracker() = default;
+
+    /** Sets the rate the retune time is measured against. */
+    void prepare (double sampleRate) noexcept;
+
+    /** Drops the correction and the current target. */
+    void reset() noexcept;
+
+    //==============================================================================
+    /** Audio side, once per block: whether to detect and correct at all. Turning it
+        off drops the correction straight away.
+    */
+    void setEnabled (bool shouldBeEnabled) noexcept;
+    bool isEnabled() const noexcept                     { return enabled; }
+
+    /** Audio side: the key (0 is C) and scale voiced frames snap to. */
+    void setScale (int newKey, Scale newScale) noexcept { key = ((newKey % 12) + 12) % 12; scale = newScale; }
+
+    /** Audio side: time constant of the glide towards the target note. */
+    void setRetuneSeconds (float seconds) noexcept      { retuneSeconds = juce::jmax (0.0f, seconds); }
+
+    /** Audio side: called by the tracking vocoder after every analysis, with the
+        detected fundamental (0 when there was none) and its clarity.
+    */
+    void addFrame (float frequency, float clarity, int numSamplesAdvanced) noexcept;
+
+    /** Audio side: the ratio every vocoder applies on top of its pitch ratios. */
+    float getCorrectionRatio() const noexcept           { return correctionRatio; }
+
+    //==============================================================================
+    /** Editor side: readings are only published while at least one viewer is attached. */
+    void addViewer() noexcept                           { numViewers.fetch_add (1, std::memory_order_relaxed); }
+    void removeViewer() noexcept                        { numViewers.fetch_sub (1, std::memory_order_relaxed); }
+
+    /** Editor side: copies the newest reading into destination and returns true if
+        one arrived since the last call.
+    */
+    bool readLatest (Reading& destination) noexcept;
+
+    //==============================================================================
+    /** The note of the scale nearest to note (a fractional MIDI note). */
+    static int snapToScale (float note, int key, Scale) noexcept;
+
+    static juce::String getNoteName (int midiNote)      { return juce::MidiMessage::getMidiNoteName (midiNote, true, true, 3); }
+
+private:
+    //==============================================================================
+    void publish (float frequency, float clarity) noexcept;
+
+    double sampleRate = 44100.0;
+    bool enabled = false;
+    int key = 0;
+    Scale scale = Scale::chromatic;
+    float retuneSeconds = 0.05f;
+
+    int targetNote = -1;            // -1 until the first pitched frame
+    float targetCorrection = 0.0f, correction = 0.0f, correctionRatio = 1.0f;
+
+    // Sequence lock: odd while a reading is being written
+    std::atomic<juce::uint32> sequence { 0 };
+    std::atomic<float> publishedFrequency { 0.0f }, publishedClarity { 0.0f }, publishedTarget { 0.0f }, publishedCorrection { 0.0f };
+    juce::uint32 lastReadSequence = 0;
+    std::atomic<int> numViewers { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchTracker)
+};
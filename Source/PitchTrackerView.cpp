@@ -0,0 +1,68 @@
+#include "PitchTrackerView.h"
+
+//==============================================================================
+PitchTrackerView::PitchTrackerView (PitchTracker& trackerToShow)
+    : tracker (trackerToShow)
+{
+    setInterceptsMouseClicks (false, false);
+    tracker.addViewer();
+    startTimerHz (refreshRateHz);
+}
+
+PitchTrackerView::~PitchTrackerView()
+{
+    stopTimer();
+    tracker.removeViewer();
+}
+
+void PitchTrackerView::timerCallback()
+{
+    if (! tracker.readLatest (reading))
+    {
+        // Readings stop while correction is off or the low-latency engine plays
+        if (++ticksSinceReading == refreshRateHz / 2)
+        {
+            text.clear();
+            repaint();
+        }
+
+        return;
+    }
+
+    ticksSinceReading = 0;
+
+    auto newText = juce::String ("Pitch  -");
+
+    if (reading.frequency > 0.0f)
+    {
+        const auto note = 69.0f + 12.0f * std::log2 (reading.frequency / 440.0f);
+        const auto nearest = juce::roundToInt (note);
+        const auto cents = juce::roundToInt (100.0f * (note - (float) nearest));
+
+        newText = "Pitch  " + PitchTracker::getNoteName (nearest) + " " + (cents >= 0 ? "+" : "") + juce::String (cents) + " ct"
+                + "  (" + juce::String (reading.frequency, 1) + " Hz)";
+    }
+
+    if (reading.targetNote >= 0.0f)
+        newText << "  ->  " << PitchTracker::getNoteName ((int) reading.targetNote)
+                << "  " << (reading.correction >= 0.0f ? "+" : "") << juce::String (reading.correction, 2) << " st";
+
+    if (newText != text)
+    {
+        text = newText;
+        repaint();
+    }
+}
+
+void PitchTrackerView::paint (juce::Graphics& g)
+{
+    if (text.isEmpty())
+        return;
+
+    g.setColour (juce::Colours::black.withAlpha (0.5f));
+    g.fillRect (getLocalBounds());
+
+    g.setColour (juce::Colour (0xff42a2c8));
+    g.setFont (juce::Font (11.0f));
+    g.drawText (text, getLocalBounds().reduced (4, 0), juce::Justification::centredLeft, true);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PitchTracker.h"
+
+//==============================================================================
+/**
+    A one-line tuner drawn over the editor: the detected note and how far off
+    it is in cents, the note it's being corrected to, and the correction being
+    applied, read from a PitchTracker. The view is attached to the tracker for
+    as long as it exists, which is what makes the audio thread publish readings.
+*/
+class PitchTrackerView  : public juce::Component,
+                          private juce::Timer
+{
+public:
+    explicit PitchTrackerView (PitchTracker&);
+    ~PitchTrackerView() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+
+    static constexpr int refreshRateHz = 30;
+
+private:
+    //==============================================================================
+    void timerCallback() override;
+
+    PitchTracker& tracker;
+    PitchTracker::Reading reading;
+    juce::String text;
+    int ticksSinceReading = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchTrackerView)
+};
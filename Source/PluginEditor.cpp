@@ -3,7 +3,8 @@
 
 //==============================================================================
 PitchMorpherAudioProcessorEditor::PitchMorpherAudioProcessorEditor (PitchMorpherAudioProcessor& p)
-    : AudioProcessorEditor (&p), processorRef (p)
+    : AudioProcessorEditor (&p), processorRef (p), spectrumView (p.getSpectrumFeed()),
+      pitchTrackerView (p.getPitchTracker())
 {
     // Set up a modern look and feel
     lookAndFeel.setColourScheme({
@@ -48,6 +49,73 @@ PitchMorpherAudioProcessorEditor::PitchMorpherAudioProcessorEditor (PitchMorpher
     latencyModeButton.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
     addAndMakeVisible(latencyModeButton);
     
+    // Configure channel link button
+    linkChannelsButton.setButtonText("Link Channels");
+    linkChannelsButton.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    addAndMakeVisible(linkChannelsButton);
+    
+    // Configure multicore button
+    multicoreButton.setButtonText("Multicore");
+    multicoreButton.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    addAndMakeVisible(multicoreButton);
+    
+    // Configure internal rate button
+    internalRateButton.setButtonText("48k Internal");
+    internalRateButton.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    addAndMakeVisible(internalRateButton);
+    
+    // Input and shifted output spectra
+    addAndMakeVisible(spectrumView);
+    
+    // Detected pitch and correction along the bottom of the spectrum
+    addAndMakeVisible(pitchTrackerView);
+    
+   #if PITCHMORPHER_PROFILING
+    // Stage timings over the top of the spectrum
+    profilerOverlay = std::make_unique<ProfilerOverlay>(processorRef.getProfiler());
+    addAndMakeVisible(*profilerOverlay);
+   #endif
+    
+    // Configure quality selector, filled from the parameter's choices
+    if (auto* qualityChoice = dynamic_cast<juce::AudioParameterChoice*>(processorRef.parameters.getParameter(processorRef.QUALITY_ID)))
+        qualityBox.addItemList(qualityChoice->choices, 1);
+    addAndMakeVisible(qualityBox);
+    
+    // Configure the harmony row: voice count and the pitch of every voice after the first
+    if (auto* voicesChoice = dynamic_cast<juce::AudioParameterChoice*>(processorRef.parameters.getParameter(processorRef.VOICES_ID)))
+        voicesBox.addItemList(voicesChoice->choices, 1);
+    addAndMakeVisible(voicesBox);
+    
+    for (auto& slider : voicePitchSliders)
+    {
+        slider.setSliderStyle(juce::Slider::LinearHorizontal);
+        slider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
+        slider.setColour(juce::Slider::trackColourId, juce::Colour(0xff42a2c8));
+        slider.setColour(juce::Slider::textBoxTextColourId, juce::Colours::white);
+        slider.setColour(juce::Slider::textBoxOutlineColourId, juce::Colour(0xff3a3a3a));
+        addAndMakeVisible(slider);
+    }
+    
+    // Configure the pitch correction row: on/off, key, scale and retune speed
+    correctionButton.setButtonText("Correction");
+    correctionButton.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    addAndMakeVisible(correctionButton);
+    
+    if (auto* keyChoice = dynamic_cast<juce::AudioParameterChoice*>(processorRef.parameters.getParameter(processorRef.KEY_ID)))
+        keyBox.addItemList(keyChoice->choices, 1);
+    addAndMakeVisible(keyBox);
+    
+    if (auto* scaleChoice = dynamic_cast<juce::AudioParameterChoice*>(processorRef.parameters.getParameter(processorRef.SCALE_ID)))
+        scaleBox.addItemList(scaleChoice->choices, 1);
+    addAndMakeVisible(scaleBox);
+    
+    retuneSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    retuneSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 60, 20);
+    retuneSlider.setColour(juce::Slider::trackColourId, juce::Colour(0xff42a2c8));
+    retuneSlider.setColour(juce::Slider::textBoxTextColourId, juce::Colours::white);
+    retuneSlider.setColour(juce::Slider::textBoxOutlineColourId, juce::Colour(0xff3a3a3a));
+    addAndMakeVisible(retuneSlider);
+    
     // Configure labels
     pitchLabel.setText("Pitch Shift", juce::dontSendNotification);
     pitchLabel.setFont(juce::Font(16.0f));
@@ -67,6 +135,24 @@ PitchMorpherAudioProcessorEditor::PitchMorpherAudioProcessorEditor (PitchMorpher
     formantLabel.setColour(juce::Label::textColourId, juce::Colours::white);
     addAndMakeVisible(formantLabel);
     
+    qualityLabel.setText("Quality", juce::dontSendNotification);
+    qualityLabel.setFont(juce::Font(16.0f));
+    qualityLabel.setJustificationType(juce::Justification::centredRight);
+    qualityLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(qualityLabel);
+    
+    voicesLabel.setText("Voices", juce::dontSendNotification);
+    voicesLabel.setFont(juce::Font(16.0f));
+    voicesLabel.setJustificationType(juce::Justification::centredRight);
+    voicesLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(voicesLabel);
+    
+    retuneLabel.setText("Retune", juce::dontSendNotification);
+    retuneLabel.setFont(juce::Font(16.0f));
+    retuneLabel.setJustificationType(juce::Justification::centredRight);
+    retuneLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    addAndMakeVisible(retuneLabel);
+    
     // Create parameter attachments
     pitchAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
         processorRef.parameters, processorRef.PITCH_ID, pitchSlider);
@@ -80,8 +166,39 @@ PitchMorpherAudioProcessorEditor::PitchMorpherAudioProcessorEditor (PitchMorpher
     latencyModeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
         processorRef.parameters, processorRef.LATENCY_MODE_ID, latencyModeButton);
     
+    linkChannelsAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.parameters, processorRef.LINK_CHANNELS_ID, linkChannelsButton);
+    
+    multicoreAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.parameters, processorRef.MULTICORE_ID, multicoreButton);
+    
+    internalRateAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.parameters, processorRef.INTERNAL_RATE_ID, internalRateButton);
+    
+    qualityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.parameters, processorRef.QUALITY_ID, qualityBox);
+    
+    voicesAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.parameters, processorRef.VOICES_ID, voicesBox);
+    
+    correctionAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+        processorRef.parameters, processorRef.CORRECTION_ID, correctionButton);
+    
+    keyAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.parameters, processorRef.KEY_ID, keyBox);
+    
+    scaleAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+        processorRef.parameters, processorRef.SCALE_ID, scaleBox);
+    
+    retuneAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+        processorRef.parameters, processorRef.RETUNE_ID, retuneSlider);
+    
+    for (size_t i = 0; i < voicePitchSliders.size(); ++i)
+        voicePitchAttachments[i] = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(
+            processorRef.parameters, processorRef.getVoiceParameterID((int) i + 1, "pitch"), voicePitchSliders[i]);
+    
     // Set the plugin's window size
-    setSize (500, 400);
+    setSize (500, 620);
 }
 
 PitchMorpherAudioProcessorEditor::~PitchMorpherAudioProcessorEditor()
@@ -112,6 +229,21 @@ void PitchMorpherAudioProcessorEditor::resized()
     // Title area
     auto titleArea = area.removeFromTop(40);
     
+    // Spectrum view under the title
+    spectrumView.setBounds(area.removeFromTop(110).reduced(10, 0));
+    
+    if (profilerOverlay != nullptr)
+        profilerOverlay->setBounds(spectrumView.getBounds().removeFromTop(16));
+    
+    pitchTrackerView.setBounds(spectrumView.getBounds().removeFromBottom(16));
+    
+    // Latency mode, channel link and multicore buttons side by side at the bottom,
+    // with the quality selector and internal rate, the harmony row and the correction row above them
+    auto buttonRow = area.removeFromBottom(30).reduced(10, 0);
+    auto qualityRow = area.removeFromBottom(30).reduced(10, 0);
+    auto voicesRow = area.removeFromBottom(40).reduced(10, 5);
+    auto correctionRow = area.removeFromBottom(40).reduced(10, 5);
+    
     // Main controls area
     auto controlsArea = area.reduced(10);
     
@@ -130,6 +262,25 @@ void PitchMorpherAudioProcessorEditor::resized()
     formantLabel.setBounds(formantArea.removeFromTop(30));
     formantSlider.setBounds(formantArea.reduced(10));
     
-    // Latency mode button at the bottom
-    latencyModeButton.setBounds(area.removeFromBottom(30).reduced(10, 0));
+    qualityLabel.setBounds(qualityRow.removeFromLeft(qualityRow.getWidth() / 3).reduced(5, 0));
+    qualityBox.setBounds(qualityRow.removeFromLeft(qualityRow.getWidth() / 2).reduced(0, 2));
+    internalRateButton.setBounds(qualityRow.reduced(10, 0));
+    
+    voicesLabel.setBounds(voicesRow.removeFromLeft(60).reduced(5, 0));
+    voicesBox.setBounds(voicesRow.removeFromLeft(90).reduced(0, 2));
+    
+    const auto voiceSliderWidth = voicesRow.getWidth() / (int) voicePitchSliders.size();
+    for (auto& slider : voicePitchSliders)
+        slider.setBounds(voicesRow.removeFromLeft(voiceSliderWidth).reduced(4, 0));
+    
+    correctionButton.setBounds(correctionRow.removeFromLeft(100));
+    keyBox.setBounds(correctionRow.removeFromLeft(60).reduced(2, 2));
+    scaleBox.setBounds(correctionRow.removeFromLeft(130).reduced(2, 2));
+    retuneLabel.setBounds(correctionRow.removeFromLeft(60).reduced(5, 0));
+    retuneSlider.setBounds(correctionRow.reduced(4, 0));
+    
+    const auto buttonWidth = buttonRow.getWidth() / 3;
+    latencyModeButton.setBounds(buttonRow.removeFromLeft(buttonWidth));
+    linkChannelsButton.setBounds(buttonRow.removeFromLeft(buttonWidth));
+    multicoreButton.setBounds(buttonRow);
 }
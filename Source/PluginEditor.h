@@ -1,7 +1,10 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "PitchTrackerView.h"
 #include "PluginProcessor.h"
+#include "ProfilerOverlay.h"
+#include "SpectrumView.h"
 
 //==============================================================================
 class PitchMorpherAudioProcessorEditor  : public juce::AudioProcessorEditor
@@ -24,17 +27,43 @@ private:
     juce::Slider mixSlider;
     juce::Slider formantSlider;
     juce::ToggleButton latencyModeButton;
+    juce::ToggleButton linkChannelsButton;
+    juce::ToggleButton multicoreButton;
+    juce::ToggleButton internalRateButton;
+    juce::ToggleButton correctionButton;
+    juce::ComboBox keyBox;
+    juce::ComboBox scaleBox;
+    juce::Slider retuneSlider;
+    juce::ComboBox qualityBox;
+    juce::ComboBox voicesBox;
+    std::array<juce::Slider, PitchMorpherAudioProcessor::maxVoices - 1> voicePitchSliders; // voices after the first
+    SpectrumView spectrumView;
+    PitchTrackerView pitchTrackerView;
+    std::unique_ptr<ProfilerOverlay> profilerOverlay; // only in profiling builds
     
     // Labels for the sliders
     juce::Label pitchLabel;
     juce::Label mixLabel;
     juce::Label formantLabel;
+    juce::Label qualityLabel;
+    juce::Label voicesLabel;
+    juce::Label retuneLabel;
     
     // Parameter attachments to link UI controls with parameters
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> pitchAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> mixAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> formantAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> latencyModeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> linkChannelsAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> multicoreAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> internalRateAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> correctionAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> keyAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> scaleAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> retuneAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> qualityAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> voicesAttachment;
+    std::array<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>, PitchMorpherAudioProcessor::maxVoices - 1> voicePitchAttachments;
     
     // Custom LookAndFeel for the sliders
     juce::LookAndFeel_V4 lookAndFeel;
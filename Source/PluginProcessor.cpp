@@ -1,11 +1,26 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "RealtimeSafety.h"
 
 // Define static parameter IDs
 const juce::String PitchMorpherAudioProcessor::PITCH_ID = "pitch";
 const juce::String PitchMorpherAudioProcessor::MIX_ID = "mix";
 const juce::String PitchMorpherAudioProcessor::FORMANT_ID = "formant";
 const juce::String PitchMorpherAudioProcessor::LATENCY_MODE_ID = "latency_mode";
+const juce::String PitchMorpherAudioProcessor::QUALITY_ID = "quality";
+const juce::String PitchMorpherAudioProcessor::LINK_CHANNELS_ID = "link_channels";
+const juce::String PitchMorpherAudioProcessor::MULTICORE_ID = "multicore";
+const juce::String PitchMorpherAudioProcessor::VOICES_ID = "voices";
+const juce::String PitchMorpherAudioProcessor::CORRECTION_ID = "pitch_correction";
+const juce::String PitchMorpherAudioProcessor::KEY_ID = "key";
+const juce::String PitchMorpherAudioProcessor::SCALE_ID = "scale";
+const juce::String PitchMorpherAudioProcessor::RETUNE_ID = "retune_speed";
+const juce::String PitchMorpherAudioProcessor::INTERNAL_RATE_ID = "internal_rate";
+
+juce::String PitchMorpherAudioProcessor::getVoiceParameterID (int voice, const juce::String& name)
+{
+    return "voice" + juce::String (voice + 1) + "_" + name;
+}
 
 //==============================================================================
 PitchMorpherAudioProcessor::PitchMorpherAudioProcessor()
@@ -21,6 +36,36 @@ PitchMorpherAudioProcessor::PitchMorpherAudioProcessor()
 #endif
        parameters (*this, nullptr, "PitchMorpher", createParameterLayout())
 {
+    pitchParam = parameters.getRawParameterValue(PITCH_ID);
+    mixParam = parameters.getRawParameterValue(MIX_ID);
+    formantParam = parameters.getRawParameterValue(FORMANT_ID);
+    latencyModeParam = parameters.getRawParameterValue(LATENCY_MODE_ID);
+    qualityParam = parameters.getRawParameterValue(QUALITY_ID);
+    linkChannelsParam = parameters.getRawParameterValue(LINK_CHANNELS_ID);
+    multicoreParam = parameters.getRawParameterValue(MULTICORE_ID);
+    voicesParam = parameters.getRawParameterValue(VOICES_ID);
+    correctionParam = parameters.getRawParameterValue(CORRECTION_ID);
+    keyParam = parameters.getRawParameterValue(KEY_ID);
+    scaleParam = parameters.getRawParameterValue(SCALE_ID);
+    retuneParam = parameters.getRawParameterValue(RETUNE_ID);
+    internalRateParam = parameters.getRawParameterValue(INTERNAL_RATE_ID);
+    
+    for (int voice = 0; voice < maxVoices; ++voice)
+    {
+        if (voice > 0)
+        {
+            voicePitchParams[(size_t) voice] = parameters.getRawParameterValue(getVoiceParameterID(voice, "pitch"));
+            voiceFormantParams[(size_t) voice] = parameters.getRawParameterValue(getVoiceParameterID(voice, "formant"));
+        }
+        
+        voiceGainParams[(size_t) voice] = parameters.getRawParameterValue(getVoiceParameterID(voice, "gain"));
+        voicePanParams[(size_t) voice] = parameters.getRawParameterValue(getVoiceParameterID(voice, "pan"));
+    }
+    
+    pitchShifter.setWorkerPool(&workerPool);
+    pitchShifter.setSpectrumFeed(&spectrumFeed);
+    pitchShifter.setPitchTracker(&pitchTracker);
+    pitchShifter.setProfiler(&profiler);
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout PitchMorpherAudioProcessor::createParameterLayout()
@@ -75,11 +120,147 @@ juce::AudioProcessorValueTreeState::ParameterLayout PitchMorpherAudioProcessor::
         false                      // Default value (high quality mode)
     ));
     
+    // Frame length of the high-quality engine: longer frames resolve low notes
+    // better but cost more CPU and latency (sizes at 44.1/48 kHz)
+    layout.add (std::make_unique<juce::AudioParameterChoice> (
+        QUALITY_ID,                // Parameter ID
+        "Quality",                 // Parameter name
+        juce::StringArray { "Draft (512)", "Low (1024)", "Standard (2048)",
+                            "High (4096)", "Ultra (8192)", "Multi-Resolution" },
+        (int) PitchShiftEngine::Quality::standard // Default value (2048-point frames)
+    ));
+    
+    // Shared phase decisions across channels, to keep stereo and surround images intact
+    layout.add (std::make_unique<juce::AudioParameterBool> (
+        LINK_CHANNELS_ID,          // Parameter ID
+        "Link Channels",           // Parameter name
+        false                      // Default value (every channel shifted on its own)
+    ));
+    
+    // Spread the channels of wide buses over a few worker threads
+    layout.add (std::make_unique<juce::AudioParameterBool> (
+        MULTICORE_ID,              // Parameter ID
+        "Multicore Processing",    // Parameter name
+        false                      // Default value (everything on the host's audio thread)
+    ));
+    
+    // Harmony voices, all shifted from one analysis of the input (choice n is n + 1 voices)
+    juce::StringArray voiceChoices;
+    for (int count = 1; count <= maxVoices; ++count)
+        voiceChoices.add (juce::String (count) + (count == 1 ? " Voice" : " Voices"));
+    
+    layout.add (std::make_unique<juce::AudioParameterChoice> (
+        VOICES_ID,                 // Parameter ID
+        "Voices",                  // Parameter name
+        voiceChoices,
+        0                          // Default value (a single shifted voice)
+    ));
+    
+    // Pitch and formant of every voice after the first (a third, a fifth and an
+    // octave up by default), then gain and pan of every voice
+    const float defaultVoicePitches[] = { 0.0f, 4.0f, 7.0f, 12.0f };
+    static_assert (std::size (defaultVoicePitches) == (size_t) maxVoices, "One default pitch per voice");
+    
+    for (int voice = 1; voice < maxVoices; ++voice)
+    {
+        const auto name = "Voice " + juce::String (voice + 1);
+        
+        layout.add (std::make_unique<juce::AudioParameterFloat> (
+            getVoiceParameterID (voice, "pitch"),
+            name + " Pitch",
+            juce::NormalisableRange<float> (-24.0f, 24.0f, 0.01f),
+            defaultVoicePitches[voice],
+            "semitones",
+            juce::AudioProcessorParameter::genericParameter,
+            [](float value, int) { return juce::String (value, 2) + " st"; }
+        ));
+        
+        layout.add (std::make_unique<juce::AudioParameterFloat> (
+            getVoiceParameterID (voice, "formant"),
+            name + " Formant",
+            juce::NormalisableRange<float> (-12.0f, 12.0f, 0.01f),
+            0.0f,
+            "semitones",
+            juce::AudioProcessorParameter::genericParameter,
+            [](float value, int) { return juce::String (value, 2) + " st"; }
+        ));
+    }
+    
+    for (int voice = 0; voice < maxVoices; ++voice)
+    {
+        const auto name = "Voice " + juce::String (voice + 1);
+        
+        layout.add (std::make_unique<juce::AudioParameterFloat> (
+            getVoiceParameterID (voice, "gain"),
+            name + " Gain",
+            juce::NormalisableRange<float> (minVoiceGainDb, 12.0f, 0.1f),
+            0.0f,                  // Default value (unity)
+            "dB",
+            juce::AudioProcessorParameter::genericParameter,
+            [](float value, int) { return value <= minVoiceGainDb ? juce::String ("-inf dB") : juce::String (value, 1) + " dB"; }
+        ));
+        
+        layout.add (std::make_unique<juce::AudioParameterFloat> (
+            getVoiceParameterID (voice, "pan"),
+            name + " Pan",
+            juce::NormalisableRange<float> (-100.0f, 100.0f, 1.0f),
+            0.0f,                  // Default value (centre)
+            "%",
+            juce::AudioProcessorParameter::genericParameter,
+            [](float value, int) { return value == 0.0f ? juce::String ("C")
+                                                        : juce::String (std::abs (int (value))) + (value < 0.0f ? "L" : "R"); }
+        ));
+    }
+    
+    // Pitch correction: the detected pitch is snapped to a key and scale, and the
+    // correction added to the pitch shift
+    layout.add (std::make_unique<juce::AudioParameterBool> (
+        CORRECTION_ID,             // Parameter ID
+        "Pitch Correction",        // Parameter name
+        false                      // Default value (off)
+    ));
+    
+    layout.add (std::make_unique<juce::AudioParameterChoice> (
+        KEY_ID,                    // Parameter ID
+        "Key",                     // Parameter name
+        juce::StringArray { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" },
+        0                          // Default value (C)
+    ));
+    
+    layout.add (std::make_unique<juce::AudioParameterChoice> (
+        SCALE_ID,                  // Parameter ID
+        "Scale",                   // Parameter name
+        juce::StringArray { "Chromatic", "Major", "Minor", "Harmonic Minor",
+                            "Major Pentatonic", "Minor Pentatonic" },
+        (int) PitchTracker::Scale::chromatic // Default value (every semitone)
+    ));
+    
+    // Time constant of the glide to the corrected note: 0 snaps instantly
+    layout.add (std::make_unique<juce::AudioParameterFloat> (
+        RETUNE_ID,                 // Parameter ID
+        "Retune Speed",            // Parameter name
+        juce::NormalisableRange<float> (0.0f, 400.0f, 1.0f, 0.5f), // Range: 0 to 400 ms, finer at the fast end
+        50.0f,                     // Default value
+        "ms",                      // Label
+        juce::AudioProcessorParameter::genericParameter, // Category
+        [](float value, int) {     // String from value function
+            return juce::String (int (value)) + " ms";
+        }
+    ));
+    
+    // Run the engine at 44.1/48 kHz in high-rate sessions, resampling around it
+    layout.add (std::make_unique<juce::AudioParameterBool> (
+        INTERNAL_RATE_ID,          // Parameter ID
+        "Fixed Internal Rate",     // Parameter name
+        false                      // Default value (the engine runs at the host rate)
+    ));
+    
     return layout;
 }
 
 PitchMorpherAudioProcessor::~PitchMorpherAudioProcessor()
 {
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -154,26 +335,123 @@ void PitchMorpherAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
     currentSampleRate = sampleRate;
     currentBlockSize = samplesPerBlock;
     
-    // Initialize working buffer for pitch shifting
-    workingBuffer.setSize(2, samplesPerBlock * 4); // Extra space for overlap
-    workingBuffer.clear();
-    
-    // Check if we're in low latency mode
+    // Check if we're in low latency mode. Offline renders have no use for it and
+    // always get the high-quality engine.
     auto* latencyParam = dynamic_cast<juce::AudioParameterBool*>(parameters.getParameter(LATENCY_MODE_ID));
     if (latencyParam != nullptr)
-        lowLatencyMode = latencyParam->get();
+        lowLatencyMode = latencyParam->get() && ! isNonRealtime();
     
-    // Set latency based on mode
-    if (lowLatencyMode)
-        setLatencySamples(0); // No latency for live use
-    else
-        setLatencySamples(samplesPerBlock); // One buffer of latency for better quality
+    // Select the engine and tier while the engines' old buffers are still valid,
+    // since a switch resets the incoming one
+    qualityTier = juce::jlimit(0, PitchShiftEngine::numQualities - 1, (int) qualityParam->load());
+    pitchShifter.setQuality((PitchShiftEngine::Quality) qualityTier);
+    pitchShifter.setMode(lowLatencyMode ? PitchShiftEngine::Mode::lowLatency
+                                        : PitchShiftEngine::Mode::highQuality);
+    
+    // Everything the audio thread touches comes out of the arena, so rebuild it here
+    const auto numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    arena.clear();
+    
+    dryChannels = arena.allocate<float*>((size_t) numChannels);
+    for (auto& channel : dryChannels)
+        channel = arena.allocate<float>((size_t) samplesPerBlock).data();
+    
+    // With a fixed internal rate, the engine runs at the host rate divided down to
+    // 44.1/48 kHz; at rates that don't divide down it stays at the host rate
+    internalRateMode = internalRateParam->load() > 0.5f;
+    const auto factor = internalRateMode ? PolyphaseResampler::chooseFactor(sampleRate) : 1;
+    
+    resampler.prepare(factor, sampleRate, numChannels, samplesPerBlock, arena);
+    dryResampler.prepare(factor, sampleRate, numChannels, samplesPerBlock, arena);
+    
+    const auto engineRate = sampleRate / factor;
+    const auto engineBlockSize = factor > 1 ? resampler.getMaxInternalBlockSize() : samplesPerBlock;
+    
+    internalChannels = {};
+    internalDryChannels = {};
+    
+    if (factor > 1)
+    {
+        internalChannels = arena.allocate<float*>((size_t) numChannels);
+        internalDryChannels = arena.allocate<float*>((size_t) numChannels);
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            internalChannels[(size_t) ch] = arena.allocate<float>((size_t) engineBlockSize).data();
+            internalDryChannels[(size_t) ch] = arena.allocate<float>((size_t) engineBlockSize).data();
+        }
+    }
+    
+    mixGains = arena.allocate<float>((size_t) samplesPerBlock);
+    dryGains = arena.allocate<float>((size_t) samplesPerBlock);
+    chunkChannels = arena.allocate<float*>((size_t) numChannels);
+    
+    // Workers only exist while multicore processing is on, so a session full of
+    // instances doesn't carry a realtime thread each that never gets work. Offline
+    // renders are already spread over the cores by the CLI and keep to one thread.
+    multicoreMode = multicoreParam->load() > 0.5f;
+    const auto numWorkers = (isNonRealtime() || ! multicoreMode)
+                              ? 0 : juce::jlimit(0, maxWorkerThreads, juce::jmin(numChannels, juce::SystemStats::getNumCpus()) - 1);
+    workerPool.start(numWorkers);
+    
+    spectrumFeed.prepare(engineRate);
+    pitchTracker.prepare(engineRate);
+    profiler.prepare(sampleRate);
+    
+    // Start every ramp at the current parameter values
+    mixSmoother.reset(sampleRate, mixRampSeconds);
+    mixSmoother.setCurrentAndTargetValue(mixParam->load() / 100.0f);
+    
+    currentPitchShift = pitchParam->load();
+    pitchShifter.setPitchRatio(std::pow(2.0f, currentPitchShift / 12.0f));
+    
+    currentFormantShift = formantParam->load();
+    pitchShifter.setFormantRatio(std::pow(2.0f, currentFormantShift / 12.0f));
+    
+    for (int voice = 1; voice < maxVoices; ++voice)
+    {
+        currentVoicePitch[(size_t) voice] = voicePitchParams[(size_t) voice]->load();
+        currentVoiceFormant[(size_t) voice] = voiceFormantParams[(size_t) voice]->load();
+        pitchShifter.setVoiceRatios(voice, std::pow(2.0f, currentVoicePitch[(size_t) voice] / 12.0f),
+                                    std::pow(2.0f, currentVoiceFormant[(size_t) voice] / 12.0f));
+    }
+    
+    // Prepare both engines and every quality tier up front; the selected one starts
+    // without a crossfade
+    pitchShifter.prepare({ engineRate, (juce::uint32) engineBlockSize, (juce::uint32) numChannels }, arena);
+    
+    // Report the real latency of the selected engine and tier. It depends only on
+    // the engine's frame length and the sample rate, never on the host's block size.
+    setLatencySamples(getTotalLatencySamples());
+}
+
+int PitchMorpherAudioProcessor::getTotalLatencySamples() const
+{
+    return pitchShifter.getLatencyInSamples() * resampler.getFactor() + resampler.getLatencyInSamples();
+}
+
+PitchMorpherAudioProcessor::MemoryUsage PitchMorpherAudioProcessor::getMemoryUsage() const
+{
+    return { arena.getBytesReserved(), SharedTables::getUsage() };
+}
+
+void PitchMorpherAudioProcessor::handleAsyncUpdate()
+{
+    // Everything is sized for the engine's rate and the number of worker lanes, so
+    // a new rate or a multicore toggle means preparing again (which also starts or
+    // stops the workers). Suspending waits for the current block to finish, and the
+    // host gets silence until processing resumes.
+    suspendProcessing(true);
+    prepareToPlay(currentSampleRate, currentBlockSize);
+    suspendProcessing(false);
 }
 
 void PitchMorpherAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    pitchShifter.reset();
+    workerPool.stop();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -183,10 +461,11 @@ bool PitchMorpherAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout up to maxChannels works: mono, stereo, surround and ambisonic
+    // buses are all just channels to the engines
+    const auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (layouts.getMainOutputChannelSet().isDisabled() || numChannels > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -204,6 +483,11 @@ void PitchMorpherAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 {
     juce::ignoreUnused (midiMessages);
     juce::ScopedNoDenormals noDenormals;
+    RealtimeSafety::ScopedRealtimeCheck realtimeCheck; // Flags any allocation or lock in debug builds
+    PITCHMORPHER_PROFILE_STAGE (&profiler, block);
+   #if PITCHMORPHER_PROFILING
+    profiler.addSamples(buffer.getNumSamples());
+   #endif
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -213,89 +497,192 @@ void PitchMorpherAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // Get parameter values
-    auto* pitchParam = parameters.getRawParameterValue(PITCH_ID);
-    auto* mixParam = parameters.getRawParameterValue(MIX_ID);
-    auto* formantParam = parameters.getRawParameterValue(FORMANT_ID);
-    auto* latencyModeParam = parameters.getRawParameterValue(LATENCY_MODE_ID);
-    
-    // Extract values
+    // Extract parameter values
     float pitchShift = pitchParam->load();
     float wetDryMix = mixParam->load() / 100.0f; // Convert from percentage to 0-1 range
     float formantShift = formantParam->load();
-    bool isLowLatencyMode = latencyModeParam->load() > 0.5f;
+    bool isLowLatencyMode = latencyModeParam->load() > 0.5f && ! isNonRealtime();
+    int quality = juce::jlimit(0, PitchShiftEngine::numQualities - 1, (int) qualityParam->load());
+    pitchShifter.setLinkedChannels(linkChannelsParam->load() > 0.5f);
+    pitchShifter.setParallelProcessing(multicoreParam->load() > 0.5f && ! isNonRealtime());
+    
+    // Hosts deliver one value per block: each new value becomes the target of a
+    // ramp that runs through the block, so steps in automation never click
+    if (pitchShift != currentPitchShift)
+    {
+        currentPitchShift = pitchShift;
+        pitchShifter.setPitchRatio(std::pow(2.0f, pitchShift / 12.0f));
+    }
+    
+    if (formantShift != currentFormantShift)
+    {
+        currentFormantShift = formantShift;
+        pitchShifter.setFormantRatio(std::pow(2.0f, formantShift / 12.0f));
+    }
+    
+    mixSmoother.setTargetValue(wetDryMix);
+    
+    // Harmony voices: ratios only move when their parameters do, gains and pans are
+    // applied per frame inside the vocoder
+    const int numVoices = juce::jlimit(1, maxVoices, (int) voicesParam->load() + 1);
+    pitchShifter.setNumVoices(numVoices);
+    
+    for (int voice = 1; voice < numVoices; ++voice)
+    {
+        const auto voicePitch = voicePitchParams[(size_t) voice]->load();
+        const auto voiceFormant = voiceFormantParams[(size_t) voice]->load();
+        
+        if (voicePitch != currentVoicePitch[(size_t) voice] || voiceFormant != currentVoiceFormant[(size_t) voice])
+        {
+            currentVoicePitch[(size_t) voice] = voicePitch;
+            currentVoiceFormant[(size_t) voice] = voiceFormant;
+            pitchShifter.setVoiceRatios(voice, std::pow(2.0f, voicePitch / 12.0f), std::pow(2.0f, voiceFormant / 12.0f));
+        }
+    }
+    
+    // Pitch correction, detected and applied inside the vocoder frame by frame
+    const bool correctionEnabled = correctionParam->load() > 0.5f;
+    pitchTracker.setEnabled(correctionEnabled);
+    pitchTracker.setScale((int) keyParam->load(),
+                          (PitchTracker::Scale) juce::jlimit(0, PitchTracker::numScales - 1, (int) scaleParam->load()));
+    pitchTracker.setRetuneSeconds(retuneParam->load() / 1000.0f);
+    
+    bool voiceMixIsNeutral = numVoices == 1;
+    
+    for (int voice = 0; voice < numVoices; ++voice)
+    {
+        const auto gainDb = voiceGainParams[(size_t) voice]->load();
+        const auto pan = voicePanParams[(size_t) voice]->load() / 100.0f;
+        pitchShifter.setVoiceMix(voice, juce::Decibels::decibelsToGain(gainDb, minVoiceGainDb), pan);
+        voiceMixIsNeutral = voiceMixIsNeutral && gainDb == 0.0f && pan == 0.0f;
+    }
     
-    // Update latency if mode changed
-    if (isLowLatencyMode != lowLatencyMode)
+    // Switch engines or tiers (crossfaded inside the engine; every tier is already
+    // prepared) and update latency if the mode or quality changed
+    if (isLowLatencyMode != lowLatencyMode || quality != qualityTier)
     {
         lowLatencyMode = isLowLatencyMode;
-        if (lowLatencyMode)
-            setLatencySamples(0);
-        else
-            setLatencySamples(currentBlockSize);
+        qualityTier = quality;
+        pitchShifter.setQuality((PitchShiftEngine::Quality) qualityTier);
+        pitchShifter.setMode(lowLatencyMode ? PitchShiftEngine::Mode::lowLatency
+                                            : PitchShiftEngine::Mode::highQuality);
+        
+        // Notifying the host is allowed to allocate
+        RealtimeSafety::ScopedUncheckedSection hostNotification;
+        setLatencySamples(getTotalLatencySamples());
     }
     
-    // Skip processing if pitch shift is zero and mix is 100% wet
-    if (std::abs(pitchShift) < 0.01f && wetDryMix > 0.99f)
+    // A change of internal rate needs the buffers resized, and switching multicore
+    // starts or stops threads, so both are handed to the message thread; this block
+    // still runs as prepared
+    const bool wantsInternalRate = internalRateParam->load() > 0.5f;
+    const bool wantsMulticore = multicoreParam->load() > 0.5f;
+    
+    if (wantsInternalRate != internalRateMode || wantsMulticore != multicoreMode)
+    {
+        internalRateMode = wantsInternalRate;
+        multicoreMode = wantsMulticore;
+        
+        RealtimeSafety::ScopedUncheckedSection messagePost;
+        triggerAsyncUpdate();
+    }
+    
+    // With no shift to apply, once the ramps have settled, the engine swaps the
+    // shifter for a plain delay of the same latency (crossfaded both ways), so
+    // the host's compensation never changes. Silent input idles on its own.
+    pitchShifter.setBypassed(std::abs(pitchShift) < 0.01f && std::abs(formantShift) < 0.01f
+                             && voiceMixIsNeutral && ! correctionEnabled && ! pitchShifter.isSmoothing());
+    
+    // Hosts may send more than the prepared block size; the buffers below only
+    // hold that many samples, so longer blocks are processed a chunk at a time
+    const auto numSamples = buffer.getNumSamples();
+    float* const* channelData = buffer.getArrayOfWritePointers();
+    
+    if (numSamples <= currentBlockSize)
+    {
+        processChunk(channelData, totalNumInputChannels, numSamples, wetDryMix);
         return;
+    }
     
-    // Create a copy of the original buffer for wet/dry mixing
-    juce::AudioBuffer<float> dryBuffer;
-    if (wetDryMix < 0.99f) // Only copy if we need to mix in some dry signal
+    jassert ((size_t) totalNumInputChannels <= chunkChannels.size());
+    
+    for (int done = 0; done < numSamples;)
     {
-        dryBuffer.makeCopyOf(buffer);
+        const int numThisTime = juce::jmin(numSamples - done, currentBlockSize);
+        
+        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+            chunkChannels[(size_t) channel] = channelData[channel] + done;
+        
+        processChunk(chunkChannels.data(), totalNumInputChannels, numThisTime, wetDryMix);
+        done += numThisTime;
     }
+}
+
+void PitchMorpherAudioProcessor::processChunk (float* const* channelData, int numChannels, int numSamples, float wetDryMix)
+{
+    jassert (numSamples <= currentBlockSize);
+    const bool mixIsRamping = mixSmoother.isSmoothing();
+    
+    // Any mix short of fully wet keeps the dry signal, so a ramp settling just
+    // under 100% carries on smoothly instead of dropping the dry part in one step
+    const bool needsDry = mixIsRamping || wetDryMix < 1.0f - 1.0e-6f;
     
-    // Simple pitch shifting implementation (placeholder)
-    // In a real implementation, this would be replaced with a proper phase vocoder
-    // or other high-quality pitch shifting algorithm
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    // Pitch shift every channel through the selected engine, which carries its
+    // state from one block to the next. When mixing, it also hands back the dry
+    // signal delayed by exactly the latency of what it played, so partial mixes
+    // line up instead of comb filtering, even across mode and quality switches.
+    if (resampler.getFactor() > 1)
     {
-        auto* channelData = buffer.getWritePointer(channel);
+        // At the internal rate the engine always hands back its dry signal, so the
+        // dry resampler's history stays current; it's only interpolated when heard
+        int numInternalSamples = 0;
         
-        // Very basic pitch shifting using simple resampling
-        // This is just a placeholder and will have artifacts
-        if (std::abs(pitchShift) > 0.01f)
         {
-            // Calculate pitch ratio (2^(semitones/12))
-            float ratio = std::pow(2.0f, pitchShift / 12.0f);
-            
-            // Simple resampling (will have artifacts, just for demonstration)
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-            {
-                float position = i / ratio;
-                int pos1 = static_cast<int>(position);
-                int pos2 = pos1 + 1;
-                float frac = position - pos1;
-                
-                // Simple linear interpolation
-                if (pos2 < buffer.getNumSamples())
-                {
-                    float sample1 = channelData[pos1];
-                    float sample2 = channelData[pos2];
-                    channelData[i] = sample1 + frac * (sample2 - sample1);
-                }
-                else
-                {
-                    // If we run out of samples, just use the last valid one
-                    channelData[i] = channelData[pos1];
-                }
-            }
+            PITCHMORPHER_PROFILE_STAGE (&profiler, resampling);
+            numInternalSamples = resampler.downsample(channelData, internalChannels.data(), numChannels, numSamples);
         }
+        
+        pitchShifter.process(internalChannels.data(), numChannels, numInternalSamples, internalDryChannels.data());
+        
+        PITCHMORPHER_PROFILE_STAGE (&profiler, resampling);
+        resampler.upsample(internalChannels.data(), numInternalSamples, channelData, numChannels, numSamples);
+        dryResampler.upsample(internalDryChannels.data(), numInternalSamples, needsDry ? dryChannels.data() : nullptr,
+                              numChannels, numSamples);
+    }
+    else
+    {
+        pitchShifter.process(channelData, numChannels, numSamples, needsDry ? dryChannels.data() : nullptr);
     }
     
     // Apply wet/dry mix if needed
-    if (wetDryMix < 0.99f)
+    if (mixIsRamping)
     {
-        for (int channel = 0; channel < totalNumInputChannels; ++channel)
+        PITCHMORPHER_PROFILE_STAGE (&profiler, mixing);
+        
+        // Per-sample gains, computed once and shared by every channel
+        for (int i = 0; i < numSamples; ++i)
+        {
+            mixGains[(size_t) i] = mixSmoother.getNextValue();
+            dryGains[(size_t) i] = 1.0f - mixGains[(size_t) i];
+        }
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* wetData = channelData[channel];
+            juce::FloatVectorOperations::multiply(wetData, mixGains.data(), numSamples);
+            juce::FloatVectorOperations::addWithMultiply(wetData, dryChannels[(size_t) channel], dryGains.data(), numSamples);
+        }
+    }
+    else if (needsDry)
+    {
+        PITCHMORPHER_PROFILE_STAGE (&profiler, mixing);
+        
+        // Static mix: plain vector maths
+        for (int channel = 0; channel < numChannels; ++channel)
         {
-            auto* wetData = buffer.getWritePointer(channel);
-            auto* dryData = dryBuffer.getReadPointer(channel);
-            
-            for (int i = 0; i < buffer.getNumSamples(); ++i)
-            {
-                wetData[i] = wetData[i] * wetDryMix + dryData[i] * (1.0f - wetDryMix);
-            }
+            auto* wetData = channelData[channel];
+            juce::FloatVectorOperations::multiply(wetData, wetDryMix, numSamples);
+            juce::FloatVectorOperations::addWithMultiply(wetData, dryChannels[(size_t) channel], 1.0f - wetDryMix, numSamples);
         }
     }
 }
@@ -1,9 +1,18 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "PitchShiftEngine.h"
+#include "PitchTracker.h"
+#include "PolyphaseResampler.h"
+#include "SharedTables.h"
+#include "RealtimeArena.h"
+#include "RealtimeWorkerPool.h"
+#include "SpectrumFeed.h"
+#include "StageProfiler.h"
 
 //==============================================================================
-class PitchMorpherAudioProcessor  : public juce::AudioProcessor
+class PitchMorpherAudioProcessor  : public juce::AudioProcessor,
+                                    private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -51,18 +60,130 @@ public:
     static const juce::String MIX_ID;
     static const juce::String FORMANT_ID;
     static const juce::String LATENCY_MODE_ID;
+    static const juce::String QUALITY_ID;
+    static const juce::String LINK_CHANNELS_ID;
+    static const juce::String MULTICORE_ID;
+    static const juce::String VOICES_ID;
+    static const juce::String CORRECTION_ID;
+    static const juce::String KEY_ID;
+    static const juce::String SCALE_ID;
+    static const juce::String RETUNE_ID;
+    static const juce::String INTERNAL_RATE_ID;
+
+    // Harmony voices shifted from one analysis. The first voice's pitch and formant
+    // are PITCH_ID and FORMANT_ID; the others have their own, and every voice has
+    // a gain and a pan, with IDs like "voice2_pitch" and "voice1_gain".
+    static constexpr int maxVoices = PhaseVocoder::maxVoices;
+    static juce::String getVoiceParameterID (int voice, const juce::String& name);
+
+    // Voice gains at this level or below are silent
+    static constexpr float minVoiceGainDb = -60.0f;
+
+    // Widest main bus accepted, enough for 7.1.4 beds and third-order ambisonics
+    static constexpr int maxChannels = 16;
+
+    // Most worker threads one instance will start for multicore processing
+    static constexpr int maxWorkerThreads = 3;
+
+    // Spectra for the editor's display, filled by the phase vocoder while it's open
+    SpectrumFeed& getSpectrumFeed() noexcept { return spectrumFeed; }
+
+    // Detected pitch and correction for the editor, published while it's open
+    PitchTracker& getPitchTracker() noexcept { return pitchTracker; }
+
+    // Per-stage timings of processBlock; only filled in builds with PITCHMORPHER_PROFILING
+    const StageProfiler& getProfiler() const noexcept { return profiler; }
+    
+    // Memory this instance holds on its own (its arena, excluding FFT plans), and
+    // the read-only tables it shares with every other instance in the process
+    struct MemoryUsage
+    {
+        size_t instanceBytes = 0;
+        SharedTables::Usage shared;
+    };
+    
+    MemoryUsage getMemoryUsage() const;
 
 private:
     // Create the parameter layout for AudioProcessorValueTreeState
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
+    // Re-prepares for a change of internal rate, which resizes everything
+    void handleAsyncUpdate() override;
+    
+    // Resamples, shifts and mixes up to the prepared block size in place
+    void processChunk (float* const* channelData, int numChannels, int numSamples, float wetDryMix);
+    
+    // What the host has to compensate: the engine's latency at the host rate,
+    // plus the resamplers' when running at the internal rate
+    int getTotalLatencySamples() const;
+    
     // DSP-related member variables
     double currentSampleRate = 44100.0;
     int currentBlockSize = 512;
     bool lowLatencyMode = false;
+    int qualityTier = (int) PitchShiftEngine::Quality::standard;
+    bool internalRateMode = false;
+    bool multicoreMode = false;
+    
+    // Raw parameter values, looked up once so processBlock never searches for them
+    std::atomic<float>* pitchParam = nullptr;
+    std::atomic<float>* mixParam = nullptr;
+    std::atomic<float>* formantParam = nullptr;
+    std::atomic<float>* latencyModeParam = nullptr;
+    std::atomic<float>* qualityParam = nullptr;
+    std::atomic<float>* linkChannelsParam = nullptr;
+    std::atomic<float>* multicoreParam = nullptr;
+    std::atomic<float>* voicesParam = nullptr;
+    std::atomic<float>* correctionParam = nullptr;
+    std::atomic<float>* keyParam = nullptr;
+    std::atomic<float>* scaleParam = nullptr;
+    std::atomic<float>* retuneParam = nullptr;
+    std::atomic<float>* internalRateParam = nullptr;
+    std::array<std::atomic<float>*, maxVoices> voicePitchParams {}, voiceFormantParams {};   // from the second voice
+    std::array<std::atomic<float>*, maxVoices> voiceGainParams {}, voicePanParams {};
+    
+    // Pitch and formant are ramped inside the engine; the ratios are only recomputed
+    // when the parameters move
+    float currentPitchShift = 0.0f;
+    float currentFormantShift = 0.0f;
+    std::array<float, maxVoices> currentVoicePitch {}, currentVoiceFormant {};
+    
+    // Per-sample wet/dry ramp, with its wet and dry gains for the current block
+    juce::SmoothedValue<float> mixSmoother { 1.0f };
+    RealtimeArena::Array<float> mixGains, dryGains;
+    static constexpr double mixRampSeconds = 0.02;
+    
+    // All memory used on the audio thread, sized in prepareToPlay
+    RealtimeArena arena;
+    
+    // Latency-aligned input for wet/dry mixing, filled by the engine (one pointer
+    // per channel into the arena)
+    RealtimeArena::Array<float*> dryChannels;
+    
+    // Views into blocks longer than the prepared size, one prepared block at a time
+    RealtimeArena::Array<float*> chunkChannels;
+    
+    // With a fixed internal rate the engine runs between these: the wet signal
+    // goes down and back up through one, the engine's dry output up through the
+    // other. Both are idle (factor 1) at the host rate.
+    PolyphaseResampler resampler, dryResampler;
+    RealtimeArena::Array<float*> internalChannels, internalDryChannels;
+    
+    // Helpers for multicore processing, started in prepareToPlay while it's switched on
+    RealtimeWorkerPool workerPool;
+    
+    // Lock-free hand-off of spectrum frames to the editor
+    SpectrumFeed spectrumFeed;
+    
+    // Pitch correction: snaps the vocoder's detected pitch to a scale
+    PitchTracker pitchTracker;
+    
+    // Stage timings, readable from the editor and the CLI
+    StageProfiler profiler;
     
-    // Buffer for pitch shifting algorithm
-    juce::AudioBuffer<float> workingBuffer;
+    // Phase vocoder (high quality) and WSOLA (low latency) engines
+    PitchShiftEngine pitchShifter;
     
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PitchMorpherAudioProcessor)
@@ -0,0 +1,221 @@
+#include "PolyphaseResampler.h"
+
+namespace
+{
+    // Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+    double besselI0 (double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 64 && term > 1.0e-12 * sum; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+//==============================================================================
+int PolyphaseResampler::chooseFactor (double hostSampleRate) noexcept
+{
+    for (int candidate : { 2, 4 })
+    {
+        const auto internalRate = hostSampleRate / candidate;
+
+        if (internalRate >= 44000.0 && internalRate <= 50000.0)
+            return candidate;
+    }
+
+    return 1;
+}
+
+void PolyphaseResampler::prepare (int newFactor, double hostSampleRate, int newNumChannels, int newMaxBlockSize, RealtimeArena& arena)
+{
+    factor = juce::jmax (1, newFactor);
+    numChannels = newNumChannels;
+    maxBlockSize = newMaxBlockSize;
+    kernels = &SpectralKernels::getBestKernels();
+
+    filter = nullptr;
+    downTaps = upTaps = downHistory = upHistory = pending = {};
+    filterLength = 1;
+
+    if (factor == 1)
+        return;
+
+    const auto key = "PolyphaseResampler factor=" + juce::String (factor) + " rate=" + juce::String (hostSampleRate);
+    filter = SharedTables::get<Filter> (key, [this, hostSampleRate] (Filter& f) { design (f, factor, hostSampleRate); });
+
+    filterLength = filter->filterLength;
+    downTaps = filter->downTaps;
+    upTaps = filter->upTaps;
+    numDownTaps = filter->numDownTaps;
+    numBranchTaps = filter->numBranchTaps;
+
+    downStride = numDownTaps - 1 + maxBlockSize;
+    upStride = numBranchTaps - 1 + getMaxInternalBlockSize();
+
+    downHistory = arena.allocate<float> ((size_t) (downStride * numChannels));
+    upHistory = arena.allocate<float> ((size_t) (upStride * numChannels));
+    pending = arena.allocate<float> ((size_t) (factor * numChannels));
+
+    reset();
+}
+
+void PolyphaseResampler::design (Filter& f, int factor, double hostSampleRate)
+{
+    // Kaiser design: the cutoff sits on the internal Nyquist frequency, midway
+    // between the passband edge and its mirror image, which is where the stopband
+    // has to start for nothing audible to alias
+    const auto internalRate = hostSampleRate / factor;
+    const auto transition = juce::MathConstants<double>::twoPi * (internalRate - 2.0 * passbandHz) / hostSampleRate;
+    const auto beta = 0.1102 * (stopbandDecibels - 8.7);
+
+    auto filterLength = (int) std::ceil ((stopbandDecibels - 7.95) / (2.285 * juce::jmax (transition, 0.01))) + 1;
+    filterLength |= 1;     // odd, so the group delay is a whole number of samples
+
+    const auto centre = (filterLength - 1) / 2;
+    const auto cutoff = 0.5 / factor;      // of the host rate
+    std::vector<double> coefficients ((size_t) filterLength);
+    double sum = 0.0;
+
+    for (int k = 0; k < filterLength; ++k)
+    {
+        const auto t = (double) (k - centre);
+        const auto x = 2.0 * cutoff * t;
+        const auto sinc = t == 0.0 ? 1.0 : std::sin (juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+        const auto position = (double) (k - centre) / centre;
+        const auto window = besselI0 (beta * std::sqrt (juce::jmax (0.0, 1.0 - position * position))) / besselI0 (beta);
+
+        coefficients[(size_t) k] = sinc * window;
+        sum += coefficients[(size_t) k];
+    }
+
+    // Unity gain at DC
+    for (auto& c : coefficients)
+        c /= sum;
+
+    // The filter is symmetric, so the decimator can take the taps in history order
+    // without reversing them; the padding goes in front, against the oldest samples
+    f.filterLength = filterLength;
+    f.numDownTaps = SpectralKernels::getPaddedBinCount (filterLength);
+    f.downTaps = f.storage.allocate<float> ((size_t) f.numDownTaps);
+
+    for (int k = 0; k < filterLength; ++k)
+        f.downTaps[(size_t) (f.numDownTaps - filterLength + k)] = (float) coefficients[(size_t) k];
+
+    // Branch r of the interpolator holds taps r, r + factor, ..., newest sample last,
+    // scaled by the factor to make up for the zeros that upsampling stuffs in
+    f.numBranchTaps = SpectralKernels::getPaddedBinCount ((filterLength + factor - 1) / factor);
+    f.upTaps = f.storage.allocate<float> ((size_t) (f.numBranchTaps * factor));
+
+    for (int r = 0; r < factor; ++r)
+        for (int j = 0; j * factor + r < filterLength; ++j)
+            f.upTaps[(size_t) (r * f.numBranchTaps + f.numBranchTaps - 1 - j)] = (float) (coefficients[(size_t) (j * factor + r)] * factor);
+}
+
+void PolyphaseResampler::reset() noexcept
+{
+    std::fill (downHistory.begin(), downHistory.end(), 0.0f);
+    std::fill (upHistory.begin(), upHistory.end(), 0.0f);
+    std::fill (pending.begin(), pending.end(), 0.0f);
+
+    // The interpolator starts a block's worth of alignment behind, so it never runs dry
+    downPhase = 0;
+    numPending = factor - 1;
+}
+
+//==============================================================================
+int PolyphaseResampler::downsample (const float* const* input, float* const* output, int numChannelsToProcess, int numSamples) noexcept
+{
+    jassert (factor > 1 && numChannelsToProcess <= numChannels && numSamples <= maxBlockSize);
+
+    // An internal sample is due at every factor-th host sample, counting on from
+    // the last block
+    const auto historyLength = numDownTaps - 1;
+    const auto first = factor - 1 - downPhase;
+    int numProduced = 0;
+
+    for (int ch = 0; ch < numChannelsToProcess; ++ch)
+    {
+        auto* history = downHistory.data() + ch * downStride;
+        juce::FloatVectorOperations::copy (history + historyLength, input[ch], numSamples);
+
+        // The window ending at host sample i starts at history[i]
+        numProduced = 0;
+
+        for (int i = first; i < numSamples; i += factor)
+            output[ch][numProduced++] = kernels->dotProduct (downTaps.data(), history + i, numDownTaps);
+
+        std::memmove (history, history + numSamples, sizeof (float) * (size_t) historyLength);
+    }
+
+    downPhase = (downPhase + numSamples) % factor;
+    return numProduced;
+}
+
+void PolyphaseResampler::upsample (const float* const* input, int numInternalSamples, float* const* output, int numChannelsToProcess, int numSamples) noexcept
+{
+    jassert (factor > 1 && numChannelsToProcess <= numChannels && numInternalSamples <= getMaxInternalBlockSize());
+
+    const auto historyLength = numBranchTaps - 1;
+    int written = 0;
+
+    for (int ch = 0; ch < numChannelsToProcess; ++ch)
+    {
+        auto* history = upHistory.data() + ch * upStride;
+        auto* held = pending.data() + ch * factor;
+        auto* out = output != nullptr ? output[ch] : nullptr;
+
+        juce::FloatVectorOperations::copy (history + historyLength, input[ch], numInternalSamples);
+
+        // The held-back samples come first, then factor new ones per internal
+        // sample; whatever is left over is held back again. Held samples are only
+        // ever moved towards the front, so that can happen in place.
+        written = 0;
+
+        auto emit = [&] (float value)
+        {
+            if (written < numSamples)
+            {
+                if (out != nullptr)
+                    out[written] = value;
+            }
+            else
+            {
+                held[written - numSamples] = value;
+            }
+
+            ++written;
+        };
+
+        for (int i = 0; i < numPending; ++i)
+            emit (held[i]);
+
+        for (int m = 0; m < numInternalSamples; ++m)
+        {
+            for (int r = 0; r < factor; ++r)
+            {
+                // Nothing to compute for a path nobody is listening to, except what's held back
+                if (out == nullptr && written < numSamples)
+                {
+                    ++written;
+                    continue;
+                }
+
+                emit (kernels->dotProduct (upTaps.data() + r * numBranchTaps, history + m, numBranchTaps));
+            }
+        }
+
+        // Only a mismatched call (fewer internal samples than the block needs) gets here
+        if (out != nullptr && written < numSamples)
+            juce::FloatVectorOperations::clear (out + written, numSamples - written);
+
+        std::memmove (history, history + numInternalSamples, sizeof (float) * (size_t) historyLength);
+    }
+
+    jassert (written >= numSamples && written - numSamples < factor);
+    numPending = juce::jlimit (0, factor - 1, written - numSamples);
+}
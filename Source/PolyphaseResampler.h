@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeArena.h"
+#include "SharedTables.h"
+#include "SpectralKernels.h"
+
+//==============================================================================
+/**
+    Converts a set of channels between the host rate and an internal rate a
+    whole factor (2 or 4) lower, so the pitch engine can run at 44.1/48 kHz
+    whatever the session rate.
+
+    Both directions use the same linear-phase, Kaiser-windowed low-pass FIR,
+    flat to passbandHz and stopbandDecibels down from the internal rate's
+    mirror image of it, so nothing below passbandHz aliases on the way down or
+    images on the way up. Everything above the passband is removed: the
+    internal rate's band edge is the mode's crossover. Only the outputs that are
+    kept are ever computed: the decimator evaluates the filter once per internal
+    sample, and the interpolator runs one polyphase branch per host sample. The
+    taps are zero-padded to the vector width and each branch is a dot product
+    through SpectralKernels, so it runs on the widest SIMD the CPU has.
+
+    Blocks needn't be multiples of the factor. The decimator produces however
+    many internal samples the block completes, and the interpolator holds back
+    up to factor - 1 host samples between blocks (it starts with that many
+    zeros), so a down-and-up trip hands back exactly as many samples as went
+    in, getLatencyInSamples() later. Downsampling and upsampling keep separate
+    state, so one instance can take the wet signal both ways while another
+    only upsamples, with the same latency.
+
+    The coefficients only depend on the factor and rate, so they come from
+    SharedTables and every resampler in the process uses the same ones. History
+    comes from the RealtimeArena in prepare(); nothing allocates afterwards.
+*/
+class PolyphaseResampler
+{
+public:
+    //==============================================================================
+    PolyphaseResampler() = default;
+
+    /** The factor that brings a host rate down to 44.1-50 kHz (2 for 88.2/96 kHz,
+        4 for 176.4/192 kHz), or 1 where no power of two up to 4 does.
+    */
+    static int chooseFactor (double hostSampleRate) noexcept;
+
+    /** Finds (or designs) the filter and takes the history from the arena. maxBlockSize is at
+        the host rate. A factor of 1 makes this a no-op. Not realtime-safe.
+    */
+    void prepare (int newFactor, double hostSampleRate, int numChannels, int maxBlockSize, RealtimeArena& arena);
+
+    /** Clears the history of both directions. */
+    void reset() noexcept;
+
+    int getFactor() const noexcept                      { return factor; }
+
+    /** Most internal samples one host block of the prepared size can turn into. */
+    int getMaxInternalBlockSize() const noexcept        { return maxBlockSize / factor + 1; }
+
+    /** Host samples between a sample going into downsample() and coming back out
+        of upsample(): the group delay of the filter, twice.
+    */
+    int getLatencyInSamples() const noexcept            { return factor > 1 ? filterLength - 1 : 0; }
+
+    /** Filters and decimates numSamples host samples per channel into output,
+        returning how many internal samples were written.
+    */
+    int downsample (const float* const* input, float* const* output, int numChannels, int numSamples) noexcept;
+
+    /** Interpolates numInternalSamples per channel (as returned by the matching
+        downsample()) into exactly numSamples host samples. With a null output
+        the history is still updated, and only the held-back samples computed,
+        so a path that is sometimes unused stays ready to be heard.
+    */
+    void upsample (const float* const* input, int numInternalSamples, float* const* output, int numChannels, int numSamples) noexcept;
+
+    static constexpr double passbandHz = 20000.0;
+    static constexpr double stopbandDecibels = 100.0;
+
+private:
+    //==============================================================================
+    // Decimation taps (padded at the front) and one padded, reversed branch per phase
+    struct Filter  : public SharedTables::Table
+    {
+        RealtimeArena::Array<float> downTaps, upTaps;
+        int filterLength = 1, numDownTaps = 0, numBranchTaps = 0;
+    };
+
+    static void design (Filter&, int factor, double hostSampleRate);
+
+    const SpectralKernels::KernelTable* kernels = nullptr;
+    int factor = 1, maxBlockSize = 0, numChannels = 0;
+    int filterLength = 1;
+
+    std::shared_ptr<const Filter> filter;
+    RealtimeArena::Array<float> downTaps, upTaps;
+    int numDownTaps = 0, numBranchTaps = 0;
+
+    // Per channel: the last taps' worth of input in each direction, then room for a
+    // block, and the host samples held back for the next block
+    RealtimeArena::Array<float> downHistory, upHistory, pending;
+    int downStride = 0, upStride = 0;
+    int downPhase = 0, numPending = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler)
+};
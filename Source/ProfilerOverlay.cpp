@@ -0,0 +1,49 @@
+#include "ProfilerOverlay.h"
+
+//==============================================================================
+ProfilerOverlay::ProfilerOverlay (const StageProfiler& profilerToShow)
+    : profiler (profilerToShow), previous (profilerToShow.getSnapshot())
+{
+    setInterceptsMouseClicks (false, false);
+    startTimerHz (refreshRateHz);
+}
+
+void ProfilerOverlay::timerCallback()
+{
+    using Stage = StageProfiler::Stage;
+
+    const auto current = profiler.getSnapshot();
+    const auto recent = current - previous;
+    previous = current;
+
+    if (recent.numSamples == 0)
+        return;
+
+    auto load = [&recent] (Stage stage)
+    {
+        return juce::String (recent.getLoadPercent (stage), 1) + "%";
+    };
+
+    text = "CPU " + load (Stage::block)
+         + " (p99 " + juce::String (recent[Stage::block].getPercentileMicroseconds (0.99), 0) + " us)"
+         + "  fifo " + load (Stage::inputFifo)
+         + "  fft " + load (Stage::analysisFft)
+         + "  bins " + load (Stage::binProcessing)
+         + "  formant " + load (Stage::formant)
+         + "  synth " + load (Stage::synthesis)
+         + "  wsola " + load (Stage::wsola)
+         + "  mix " + load (Stage::mixing)
+         + "  resample " + load (Stage::resampling);
+
+    repaint();
+}
+
+void ProfilerOverlay::paint (juce::Graphics& g)
+{
+    g.setColour (juce::Colours::black.withAlpha (0.5f));
+    g.fillRect (getLocalBounds());
+
+    g.setColour (juce::Colour (0xffffd060));
+    g.setFont (juce::Font (11.0f));
+    g.drawText (text, getLocalBounds().reduced (4, 0), juce::Justification::centredLeft, true);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StageProfiler.h"
+
+//==============================================================================
+/**
+    A one-line CPU meter drawn over the editor: the load of the whole of
+    processBlock and of each stage over the last refresh interval, plus the
+    99th-percentile block time. Only shown in builds with PITCHMORPHER_PROFILING.
+*/
+class ProfilerOverlay  : public juce::Component,
+                         private juce::Timer
+{
+public:
+    explicit ProfilerOverlay (const StageProfiler&);
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+
+    static constexpr int refreshRateHz = 4;
+
+private:
+    //==============================================================================
+    void timerCallback() override;
+
+    const StageProfiler& profiler;
+    StageProfiler::Snapshot previous;
+    juce::String text;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProfilerOverlay)
+};
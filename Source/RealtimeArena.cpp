@@ -0,0 +1,46 @@
+#include "RealtimeArena.h"
+
+//==============================================================================
+void RealtimeArena::clear()
+{
+    blocks.clear();
+    bytesAllocated = 0;
+}
+
+size_t RealtimeArena::getBytesReserved() const noexcept
+{
+    size_t total = 0;
+
+    for (auto& block : blocks)
+        total += block->size;
+
+    return total;
+}
+
+void* RealtimeArena::allocateBytes (size_t numBytes, size_t minAlignment)
+{
+    jassert (minAlignment <= alignment);
+    juce::ignoreUnused (minAlignment);
+
+    // Keep every allocation on its own cache lines
+    const auto padded = (juce::jmax ((size_t) 1, numBytes) + alignment - 1) & ~(alignment - 1);
+
+    if (blocks.empty() || blocks.back()->size - blocks.back()->used < padded)
+    {
+        auto block = std::make_unique<Block>();
+        block->size = juce::jmax (minimumBlockSize, padded);
+        block->storage.calloc (block->size + alignment);
+
+        const auto address = reinterpret_cast<std::uintptr_t> (block->storage.get());
+        block->start = block->storage.get() + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+
+        blocks.push_back (std::move (block));
+    }
+
+    auto& block = *blocks.back();
+    auto* result = block.start + block.used;
+    block.used += padded;
+    bytesAllocated += padded;
+
+    return result;
+}
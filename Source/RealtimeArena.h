@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Bump allocator for everything the audio thread touches.
+
+    The processor clears it at the top of prepareToPlay() and every engine carves
+    its FIFOs, frames and scratch buffers out of it while preparing. Blocks are
+    only ever added, so earlier allocations stay put, and nothing is freed until
+    the next clear(). Allocations are zeroed and 64-byte aligned.
+*/
+class RealtimeArena
+{
+public:
+    //==============================================================================
+    /** A non-owning view of an array living in the arena. */
+    template <typename Type>
+    struct Array
+    {
+        Type* data() const noexcept                     { return elements; }
+        size_t size() const noexcept                    { return count; }
+        Type* begin() const noexcept                    { return elements; }
+        Type* end() const noexcept                      { return elements + count; }
+        Type& operator[] (size_t index) const noexcept  { jassert (index < count); return elements[index]; }
+
+        Type* elements = nullptr;
+        size_t count = 0;
+    };
+
+    RealtimeArena() = default;
+
+    /** An arena reserving blocks of at least blockSize bytes, for small, long-lived users. */
+    explicit RealtimeArena (size_t blockSize) noexcept  : minimumBlockSize (blockSize) {}
+
+    /** Releases every block. Arrays handed out before become invalid. */
+    void clear();
+
+    /** Returns zeroed storage for count objects. Only call this while preparing. */
+    template <typename Type>
+    Array<Type> allocate (size_t count)
+    {
+        static_assert (std::is_trivially_copyable<Type>::value && std::is_trivially_destructible<Type>::value,
+                       "Arena storage is never constructed or destroyed");
+
+        return { static_cast<Type*> (allocateBytes (count * sizeof (Type), alignof (Type))), count };
+    }
+
+    /** Bytes handed out since the last clear(). */
+    size_t getBytesAllocated() const noexcept           { return bytesAllocated; }
+
+    /** Bytes reserved from the system, including unused space at the end of blocks. */
+    size_t getBytesReserved() const noexcept;
+
+    static constexpr size_t alignment = 64;
+
+private:
+    //==============================================================================
+    void* allocateBytes (size_t numBytes, size_t minAlignment);
+
+    struct Block
+    {
+        juce::HeapBlock<char> storage;
+        char* start = nullptr;
+        size_t size = 0, used = 0;
+    };
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    size_t bytesAllocated = 0;
+
+    static constexpr size_t defaultBlockSize = 256 * 1024;
+    size_t minimumBlockSize = defaultBlockSize;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeArena)
+};
@@ -0,0 +1,175 @@
+#include "RealtimeSafety.h"
+
+#if PITCHMORPHER_REALTIME_CHECKS
+
+#include <new>
+
+#if PITCHMORPHER_REALTIME_LIBC_HOOKS
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+namespace
+{
+    // Plain ints need no dynamic initialisation, so they're safe to touch from inside malloc
+    thread_local int checkDepth = 0;
+    std::atomic<int> violationCounts[3] {};
+}
+
+//==============================================================================
+void RealtimeSafety::noteOperation (Violation violation) noexcept
+{
+    if (checkDepth <= 0)
+        return;
+
+    // Disarm while reporting: the assertion itself logs, and so allocates
+    const auto savedDepth = checkDepth;
+    checkDepth = 0;
+
+    violationCounts[(int) violation].fetch_add (1, std::memory_order_relaxed);
+
+    // Something called from processBlock allocated, freed or locked: check the call stack
+    jassertfalse;
+
+    checkDepth = savedDepth;
+}
+
+int RealtimeSafety::getNumViolations (Violation violation) noexcept
+{
+    return violationCounts[(int) violation].load (std::memory_order_relaxed);
+}
+
+RealtimeSafety::ScopedRealtimeCheck::ScopedRealtimeCheck() noexcept      { ++checkDepth; }
+RealtimeSafety::ScopedRealtimeCheck::~ScopedRealtimeCheck() noexcept     { --checkDepth; }
+
+RealtimeSafety::ScopedUncheckedSection::ScopedUncheckedSection() noexcept  : savedDepth (checkDepth)  { checkDepth = 0; }
+RealtimeSafety::ScopedUncheckedSection::~ScopedUncheckedSection() noexcept { checkDepth = savedDepth; }
+
+//==============================================================================
+#if PITCHMORPHER_REALTIME_LIBC_HOOKS
+
+// glibc exports its allocator under these names too, so the replacements below
+// can forward to it without going through dlsym
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void  __libc_free (void*);
+}
+
+namespace
+{
+    void* systemMalloc (size_t size) noexcept     { return __libc_malloc (size); }
+    void systemFree (void* ptr) noexcept          { __libc_free (ptr); }
+
+    using MutexLockFunction = int (*) (pthread_mutex_t*);
+
+    MutexLockFunction getSystemMutexLock() noexcept
+    {
+        static auto function = reinterpret_cast<MutexLockFunction> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+        return function;
+    }
+
+    // Resolve the real lock function at load time, before any audio thread runs
+    const auto systemMutexLockAtLoad = getSystemMutexLock();
+}
+
+// Only ever built into the command-line executables, where the whole process
+// goes through these and so through one allocator. In a plugin, memory could
+// cross between them and whatever allocator the host was started with.
+extern "C"
+{
+    void* malloc (size_t size)
+    {
+        RealtimeSafety::noteOperation (RealtimeSafety::Violation::allocation);
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        RealtimeSafety::noteOperation (RealtimeSafety::Violation::allocation);
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* ptr, size_t size)
+    {
+        RealtimeSafety::noteOperation (RealtimeSafety::Violation::allocation);
+        return __libc_realloc (ptr, size);
+    }
+
+    void free (void* ptr)
+    {
+        if (ptr != nullptr)
+            RealtimeSafety::noteOperation (RealtimeSafety::Violation::deallocation);
+
+        __libc_free (ptr);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        RealtimeSafety::noteOperation (RealtimeSafety::Violation::lock);
+
+        auto* function = systemMutexLockAtLoad != nullptr ? systemMutexLockAtLoad : getSystemMutexLock();
+        return function (mutex);
+    }
+}
+
+#else
+
+// Whatever malloc the process resolves to, so memory from these operators can be
+// freed by code outside the plugin, and the other way round
+namespace
+{
+    void* systemMalloc (size_t size) noexcept     { return std::malloc (size); }
+    void systemFree (void* ptr) noexcept          { std::free (ptr); }
+}
+
+#endif
+
+//==============================================================================
+// Replacements for the global (non-aligned) operator new and delete
+namespace
+{
+    void* checkedNew (size_t size) noexcept
+    {
+        RealtimeSafety::noteOperation (RealtimeSafety::Violation::allocation);
+        return systemMalloc (size != 0 ? size : 1);
+    }
+
+    void checkedDelete (void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            RealtimeSafety::noteOperation (RealtimeSafety::Violation::deallocation);
+
+        systemFree (ptr);
+    }
+}
+
+void* operator new (size_t size)
+{
+    if (auto* ptr = checkedNew (size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size)
+{
+    if (auto* ptr = checkedNew (size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept        { return checkedNew (size); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept      { return checkedNew (size); }
+
+void operator delete (void* ptr) noexcept                               { checkedDelete (ptr); }
+void operator delete[] (void* ptr) noexcept                             { checkedDelete (ptr); }
+void operator delete (void* ptr, size_t) noexcept                       { checkedDelete (ptr); }
+void operator delete[] (void* ptr, size_t) noexcept                     { checkedDelete (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept        { checkedDelete (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept      { checkedDelete (ptr); }
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef PITCHMORPHER_REALTIME_CHECKS
+ #define PITCHMORPHER_REALTIME_CHECKS JUCE_DEBUG
+#endif
+
+// Replacing malloc and friends is only safe when the whole process uses the
+// replacements, so only the command-line executables turn this on
+#if ! defined (PITCHMORPHER_REALTIME_LIBC_HOOKS) || ! PITCHMORPHER_REALTIME_CHECKS || ! defined (__GLIBC__)
+ #undef PITCHMORPHER_REALTIME_LIBC_HOOKS
+ #define PITCHMORPHER_REALTIME_LIBC_HOOKS 0
+#endif
+
+//==============================================================================
+/**
+    Debug-build guard against allocating or locking on the audio thread.
+
+    While a ScopedRealtimeCheck is alive on a thread, the replaced global operator
+    new and delete count every call made on that thread as a violation and hit a
+    jassert, so the debugger stops on the offending call stack. They forward to
+    the process's malloc and free, so plugin builds stay compatible with hosts
+    running another allocator.
+
+    The command-line tools also define PITCHMORPHER_REALTIME_LIBC_HOOKS, which on
+    glibc replaces malloc, calloc, realloc, free and pthread_mutex_lock as well.
+    That is never done in the plugin: replacing the C allocator is only safe when
+    every allocation in the process goes through the replacement.
+
+    Enabled by default in debug builds; set PITCHMORPHER_REALTIME_CHECKS to 1 to
+    count violations in a release build (e.g. for benchmarks) or to 0 to compile
+    everything here away.
+*/
+namespace RealtimeSafety
+{
+    enum class Violation
+    {
+        allocation,
+        deallocation,
+        lock
+    };
+
+   #if PITCHMORPHER_REALTIME_CHECKS
+    /** Marks the calling thread as realtime for the lifetime of the object. */
+    class ScopedRealtimeCheck
+    {
+    public:
+        ScopedRealtimeCheck() noexcept;
+        ~ScopedRealtimeCheck() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeCheck)
+    };
+
+    /** Suspends checking inside a ScopedRealtimeCheck, for calls that are allowed
+        to block, such as notifying the host of a latency change.
+    */
+    class ScopedUncheckedSection
+    {
+    public:
+        ScopedUncheckedSection() noexcept;
+        ~ScopedUncheckedSection() noexcept;
+
+    private:
+        int savedDepth;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedUncheckedSection)
+    };
+
+    /** Counts a violation if the calling thread is inside a ScopedRealtimeCheck. */
+    void noteOperation (Violation) noexcept;
+
+    /** Violations of one kind counted since the process started. */
+    int getNumViolations (Violation) noexcept;
+
+    constexpr bool isEnabled = true;
+   #else
+    struct ScopedRealtimeCheck      { ScopedRealtimeCheck() noexcept {} };
+    struct ScopedUncheckedSection   { ScopedUncheckedSection() noexcept {} };
+
+    inline void noteOperation (Violation) noexcept {}
+    inline int getNumViolations (Violation) noexcept    { return 0; }
+
+    constexpr bool isEnabled = false;
+   #endif
+}
@@ -0,0 +1,229 @@
+#include "RealtimeWorkerPool.h"
+#include "RealtimeSafety.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <semaphore.h>
+#endif
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    // Eases off the core (and the other hyperthread) while spinning
+    inline void pauseWhileSpinning() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_CLANG || JUCE_GCC)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+}
+
+//==============================================================================
+#if JUCE_MAC || JUCE_IOS
+struct RealtimeWorkerPool::Semaphore::Native
+{
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create (0);
+    ~Native()                                           { dispatch_release (semaphore); }
+
+    void post() noexcept                                { dispatch_semaphore_signal (semaphore); }
+    void wait() noexcept                                { dispatch_semaphore_wait (semaphore, DISPATCH_TIME_FOREVER); }
+};
+#elif JUCE_WINDOWS
+struct RealtimeWorkerPool::Semaphore::Native
+{
+    HANDLE semaphore = CreateSemaphoreW (nullptr, 0, 0x7fffffff, nullptr);
+    ~Native()                                           { CloseHandle (semaphore); }
+
+    void post() noexcept                                { ReleaseSemaphore (semaphore, 1, nullptr); }
+    void wait() noexcept                                { WaitForSingleObject (semaphore, INFINITE); }
+};
+#else
+struct RealtimeWorkerPool::Semaphore::Native
+{
+    sem_t semaphore;
+    Native()                                            { sem_init (&semaphore, 0, 0); }
+    ~Native()                                           { sem_destroy (&semaphore); }
+
+    // sem_post is a futex operation, with no mutex behind it
+    void post() noexcept                                { sem_post (&semaphore); }
+    void wait() noexcept                                { while (sem_wait (&semaphore) != 0 && errno == EINTR) {} }
+};
+#endif
+
+RealtimeWorkerPool::Semaphore::Semaphore() : native (std::make_unique<Native>()) {}
+RealtimeWorkerPool::Semaphore::~Semaphore() = default;
+
+void RealtimeWorkerPool::Semaphore::post() noexcept     { native->post(); }
+void RealtimeWorkerPool::Semaphore::wait() noexcept     { native->wait(); }
+
+//==============================================================================
+class RealtimeWorkerPool::Worker  : public juce::Thread
+{
+public:
+    Worker (RealtimeWorkerPool& poolToUse, int lane)
+        : juce::Thread ("PitchMorpher worker " + juce::String (lane)), pool (poolToUse), laneIndex (lane)
+    {
+    }
+
+    void run() override                                 { pool.workerLoop (*this); }
+
+    void wakeForExit()
+    {
+        signalThreadShouldExit();
+        wakeUp.post();
+    }
+
+    RealtimeWorkerPool& pool;
+    const int laneIndex;
+
+    std::atomic<bool> asleep { false };
+    Semaphore wakeUp;
+};
+
+//==============================================================================
+RealtimeWorkerPool::RealtimeWorkerPool() = default;
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    stop();
+}
+
+void RealtimeWorkerPool::start (int numWorkers)
+{
+    numWorkers = juce::jmax (0, numWorkers);
+
+    if (numWorkers == getNumWorkers())
+        return;
+
+    stop();
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back (std::make_unique<Worker> (*this, i + 1));
+        auto& worker = *workers.back();
+
+        // Realtime scheduling may be refused (e.g. without rtprio on Linux); the
+        // inline fallback keeps a merely high-priority worker safe to use
+        if (! worker.startRealtimeThread (juce::Thread::RealtimeOptions{}.withPriority (9)))
+            worker.startThread (juce::Thread::Priority::highest);
+    }
+
+    numTasksOnWorkers = 0;
+    numTasksInline = 0;
+}
+
+void RealtimeWorkerPool::stop()
+{
+    for (auto& worker : workers)
+        worker->wakeForExit();
+
+    for (auto& worker : workers)
+        worker->stopThread (-1);
+
+    workers.clear();
+}
+
+//==============================================================================
+void RealtimeWorkerPool::runTasks (int numTasks, TaskFunction function, void* context) noexcept
+{
+    jassert (numTasks < 0x10000);
+
+    if (numTasks <= 0)
+        return;
+
+    if (workers.empty() || numTasks == 1)
+    {
+        for (int i = 0; i < numTasks; ++i)
+            function (context, i, 0);
+
+        numTasksInline.fetch_add (numTasks, std::memory_order_relaxed);
+        return;
+    }
+
+    taskFunction = function;
+    taskContext = context;
+    numFinished.store (0, std::memory_order_relaxed);
+
+    const auto thisGeneration = ++generation;
+    batch.store (makeBatch (thisGeneration, numTasks, 0), std::memory_order_seq_cst);
+
+    // Wake only the sleeping workers that have something to do. A worker that
+    // fell asleep just before the batch went out has set its flag first, so it
+    // is either seen here or sees the batch itself.
+    const auto numHelpers = juce::jmin (numTasks - 1, getNumWorkers());
+
+    for (int i = 0; i < numHelpers; ++i)
+        if (workers[(size_t) i]->asleep.exchange (false, std::memory_order_seq_cst))
+            workers[(size_t) i]->wakeUp.post();
+
+    // Work alongside them, then wait only for the tasks they have already taken
+    numTasksInline.fetch_add (claimAndRun (thisGeneration, 0), std::memory_order_relaxed);
+
+    while (numFinished.load (std::memory_order_acquire) < numTasks)
+        pauseWhileSpinning();
+}
+
+int RealtimeWorkerPool::claimAndRun (juce::uint32 batchGeneration, int laneIndex) noexcept
+{
+    int numRun = 0;
+    auto current = batch.load (std::memory_order_acquire);
+
+    while (getGeneration (current) == batchGeneration && getNextTask (current) < getNumTasks (current))
+    {
+        if (! batch.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        // The batch can't move on before this task finishes, so these are stable
+        taskFunction (taskContext, getNextTask (current), laneIndex);
+        numFinished.fetch_add (1, std::memory_order_release);
+        ++numRun;
+
+        current = batch.load (std::memory_order_acquire);
+    }
+
+    return numRun;
+}
+
+void RealtimeWorkerPool::workerLoop (Worker& worker)
+{
+    const auto spinTicks = juce::Time::secondsToHighResolutionTicks (spinSeconds);
+    auto lastGeneration = getGeneration (batch.load (std::memory_order_acquire));
+
+    while (! worker.threadShouldExit())
+    {
+        // Spin for a moment, since the next frame is usually close behind
+        const auto spinEnd = juce::Time::getHighResolutionTicks() + spinTicks;
+        auto current = getGeneration (batch.load (std::memory_order_acquire));
+
+        while (current == lastGeneration && juce::Time::getHighResolutionTicks() < spinEnd)
+        {
+            pauseWhileSpinning();
+            current = getGeneration (batch.load (std::memory_order_acquire));
+        }
+
+        if (current == lastGeneration)
+        {
+            // Announce the sleep before the last look, so run() can't miss it
+            worker.asleep.store (true, std::memory_order_seq_cst);
+
+            if (getGeneration (batch.load (std::memory_order_seq_cst)) == lastGeneration && ! worker.threadShouldExit())
+                worker.wakeUp.wait();
+
+            worker.asleep.store (false, std::memory_order_relaxed);
+            continue;
+        }
+
+        lastGeneration = current;
+
+        RealtimeSafety::ScopedRealtimeCheck realtimeCheck;
+        numTasksOnWorkers.fetch_add (claimAndRun (current, worker.laneIndex), std::memory_order_relaxed);
+    }
+}
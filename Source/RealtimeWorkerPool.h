@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A few realtime-priority threads that help the audio thread through
+    independent tasks, such as the channels of one frame.
+
+    run() hands a batch over without locking or allocating: the tasks are
+    published in a single atomic word and the calling thread starts on them
+    straight away. Workers claim tasks one at a time, so anything a late or
+    descheduled worker hasn't claimed yet is simply done inline, and run() only
+    ever waits for tasks that are already underway.
+
+    After each batch the workers spin for spinSeconds, so the frames of one
+    block reach them without a wake-up, then sleep on a semaphore that run()
+    posts only for workers that are asleep.
+*/
+class RealtimeWorkerPool
+{
+public:
+    //==============================================================================
+    RealtimeWorkerPool();
+    ~RealtimeWorkerPool();
+
+    /** Runs numWorkers threads, restarting them if the count changed. Not realtime-safe. */
+    void start (int numWorkers);
+
+    /** Stops every worker. Not realtime-safe. */
+    void stop();
+
+    int getNumWorkers() const noexcept                  { return (int) workers.size(); }
+
+    /** Threads that can be running tasks at once: the workers and the caller of run(). */
+    int getNumLanes() const noexcept                    { return getNumWorkers() + 1; }
+
+    /** Calls task (taskIndex, laneIndex) once for every task in [0, numTasks) and
+        returns once all of them have finished. Lane 0 is the calling thread and
+        each worker has a lane of its own, so the lane can pick per-thread scratch.
+        Only one thread may be inside run() at a time.
+    */
+    template <typename Task>
+    void run (int numTasks, Task&& task) noexcept
+    {
+        using TaskType = std::remove_reference_t<Task>;
+
+        runTasks (numTasks, [] (void* context, int taskIndex, int laneIndex)
+                  {
+                      (*static_cast<TaskType*> (context)) (taskIndex, laneIndex);
+                  },
+                  &task);
+    }
+
+    /** Tasks run on the workers and on the calling thread since start(); their
+        ratio shows how much the pool is actually taking off the audio thread.
+    */
+    juce::int64 getNumTasksOnWorkers() const noexcept   { return numTasksOnWorkers.load (std::memory_order_relaxed); }
+    juce::int64 getNumTasksInline() const noexcept      { return numTasksInline.load (std::memory_order_relaxed); }
+
+    static constexpr double spinSeconds = 0.0002;
+
+private:
+    //==============================================================================
+    using TaskFunction = void (*) (void* context, int taskIndex, int laneIndex);
+
+    // Posting never takes a lock, so the audio thread can wake a worker
+    class Semaphore
+    {
+    public:
+        Semaphore();
+        ~Semaphore();
+
+        void post() noexcept;
+        void wait() noexcept;
+
+    private:
+        struct Native;
+        std::unique_ptr<Native> native;
+
+        JUCE_DECLARE_NON_COPYABLE (Semaphore)
+    };
+
+    class Worker;
+
+    void runTasks (int numTasks, TaskFunction, void* context) noexcept;
+    int claimAndRun (juce::uint32 generation, int laneIndex) noexcept;
+    void workerLoop (Worker&);
+
+    // The batch word: generation in the top 32 bits, task count and next unclaimed
+    // task in 16 bits each, so a worker can never claim a task of a finished batch
+    static juce::uint64 makeBatch (juce::uint32 generation, int numTasks, int nextTask) noexcept
+    {
+        return ((juce::uint64) generation << 32) | ((juce::uint64) numTasks << 16) | (juce::uint64) nextTask;
+    }
+
+    static juce::uint32 getGeneration (juce::uint64 batch) noexcept { return (juce::uint32) (batch >> 32); }
+    static int getNumTasks (juce::uint64 batch) noexcept            { return (int) ((batch >> 16) & 0xffff); }
+    static int getNextTask (juce::uint64 batch) noexcept            { return (int) (batch & 0xffff); }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::atomic<juce::uint64> batch { 0 };
+    std::atomic<int> numFinished { 0 };
+    juce::uint32 generation = 0;
+
+    // Only rewritten once every task of the previous batch has finished
+    TaskFunction taskFunction = nullptr;
+    void* taskContext = nullptr;
+
+    std::atomic<juce::int64> numTasksOnWorkers { 0 }, numTasksInline { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeWorkerPool)
+};
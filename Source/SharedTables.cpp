@@ -0,0 +1,60 @@
+#include "SharedTables.h"
+#include <map>
+#include <mutex>
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex lock;
+        std::map<juce::String, std::weak_ptr<const SharedTables::Table>> tables;
+    };
+
+    // Never destroyed, so instances released during static destruction still find it
+    Registry& getRegistry()
+    {
+        static auto* registry = new Registry();
+        return *registry;
+    }
+}
+
+namespace SharedTables
+{
+
+std::shared_ptr<const Table> findOrBuild (const juce::String& key, const std::function<std::shared_ptr<Table>()>& build)
+{
+    auto& registry = getRegistry();
+    const std::lock_guard<std::mutex> guard (registry.lock);
+
+    // Drop the entries nobody holds any more while we're here
+    for (auto it = registry.tables.begin(); it != registry.tables.end();)
+        it = it->second.expired() ? registry.tables.erase (it) : std::next (it);
+
+    if (auto existing = registry.tables[key].lock())
+        return existing;
+
+    // Built under the lock, so instances preparing at once never build the same table twice
+    std::shared_ptr<const Table> table = build();
+    registry.tables[key] = table;
+    return table;
+}
+
+Usage getUsage()
+{
+    auto& registry = getRegistry();
+    const std::lock_guard<std::mutex> guard (registry.lock);
+    Usage usage;
+
+    for (auto& entry : registry.tables)
+    {
+        if (auto table = entry.second.lock())
+        {
+            ++usage.numTables;
+            usage.numBytes += table->storage.getBytesReserved();
+        }
+    }
+
+    return usage;
+}
+
+} // namespace SharedTables
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeArena.h"
+
+//==============================================================================
+/**
+    Process-wide registry of the read-only tables the engines derive from their
+    settings (analysis windows, phase advances, resampler kernels), so every
+    instance prepared the same way shares one copy instead of building its own.
+
+    A table is found by a key naming everything it depends on, e.g.
+    "PhaseVocoder size=2048 overlap=4 lags=735", and built the first time any
+    instance asks for that key. It is handed out as a shared pointer to const, so
+    it stays alive while any instance holds it and is freed with the last one;
+    the next instance to ask builds it again. Each table's arrays come from its
+    own RealtimeArena, so they are 64-byte aligned like everything else the
+    kernels read.
+
+    Lookups take a lock and may build, so they belong in prepare(). The audio
+    thread only reads through the views the engines keep, never the registry.
+*/
+namespace SharedTables
+{
+    /** Base of every shared table: the arena its arrays live in. */
+    struct Table
+    {
+        virtual ~Table() = default;
+
+        RealtimeArena storage { blockSize };
+
+        // Small, so a table doesn't reserve much more than it holds
+        static constexpr size_t blockSize = 4096;
+    };
+
+    /** Live tables and the bytes they reserve, for the whole process. */
+    struct Usage
+    {
+        int numTables = 0;
+        size_t numBytes = 0;
+    };
+
+    Usage getUsage();
+
+    /** Implementation detail of get(): finds the key, or stores what build returns. */
+    std::shared_ptr<const Table> findOrBuild (const juce::String& key, const std::function<std::shared_ptr<Table>()>& build);
+
+    /** Returns the table for key, calling build (TableType&) to fill in a new one if
+        no instance holds it. The key has to name the table type as well as the
+        settings, as each key only ever maps to one type.
+    */
+    template <typename TableType, typename Builder>
+    std::shared_ptr<const TableType> get (const juce::String& key, Builder&& build)
+    {
+        static_assert (std::is_base_of<Table, TableType>::value, "Shared tables derive from SharedTables::Table");
+
+        auto table = findOrBuild (key, [&build]
+        {
+            auto newTable = std::make_shared<TableType>();
+            build (*newTable);
+            return std::shared_ptr<Table> (std::move (newTable));
+        });
+
+        jassert (dynamic_cast<const TableType*> (table.get()) != nullptr);
+        return std::static_pointer_cast<const TableType> (table);
+    }
+}
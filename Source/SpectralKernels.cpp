@@ -0,0 +1,72 @@
+#include <JuceHeader.h>
+#include "SpectralKernelsImpl.h"
+
+namespace
+{
+    struct ScalarOps
+    {
+        using Reg  = float;
+        using Mask = bool;
+        static constexpr int width = 1;
+
+        static Reg load (const float* p) noexcept                 { return *p; }
+        static void store (float* p, Reg v) noexcept              { *p = v; }
+        static Reg set (float v) noexcept                         { return v; }
+        static Reg ramp (float start) noexcept                    { return start; }
+        static Reg add (Reg a, Reg b) noexcept                    { return a + b; }
+        static Reg sub (Reg a, Reg b) noexcept                    { return a - b; }
+        static Reg mul (Reg a, Reg b) noexcept                    { return a * b; }
+        static Reg mulAdd (Reg a, Reg b, Reg c) noexcept          { return a * b + c; }
+        static Reg div (Reg a, Reg b) noexcept                    { return a / b; }
+        static Reg sqrt (Reg a) noexcept                          { return std::sqrt (a); }
+        static Reg abs (Reg a) noexcept                           { return std::abs (a); }
+        static Reg min (Reg a, Reg b) noexcept                    { return b < a ? b : a; }
+        static Reg max (Reg a, Reg b) noexcept                    { return a < b ? b : a; }
+        static Reg round (Reg a) noexcept                         { return std::nearbyint (a); }
+        static Mask lessThan (Reg a, Reg b) noexcept              { return a < b; }
+        static Mask greaterThan (Reg a, Reg b) noexcept           { return a > b; }
+        static Reg select (Mask m, Reg a, Reg b) noexcept         { return m ? a : b; }
+    };
+}
+
+namespace SpectralKernels
+{
+
+const KernelTable* getKernels (InstructionSet set) noexcept
+{
+    switch (set)
+    {
+        case InstructionSet::scalar:
+        {
+            static const auto table = SpectralKernelsImpl<ScalarOps>::makeTable ("scalar");
+            return &table;
+        }
+
+        case InstructionSet::sse2:
+            return getSSE2Kernels();
+
+        case InstructionSet::avx2:
+            return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() ? getAVX2Kernels() : nullptr;
+
+        case InstructionSet::avx512:
+            return juce::SystemStats::hasAVX512F() ? getAVX512Kernels() : nullptr;
+    }
+
+    return nullptr;
+}
+
+const KernelTable& getBestKernels() noexcept
+{
+    static const KernelTable& best = []() -> const KernelTable&
+    {
+        for (auto set : { InstructionSet::avx512, InstructionSet::avx2, InstructionSet::sse2 })
+            if (auto* table = getKernels (set))
+                return *table;
+
+        return *getKernels (InstructionSet::scalar);
+    }();
+
+    return best;
+}
+
+} // namespace SpectralKernels
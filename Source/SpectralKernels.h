@@ -0,0 +1,69 @@
+#pragma once
+
+//==============================================================================
+/**
+    Per-bin phase-vocoder kernels, working on structure-of-arrays bin data, and
+    the dot product behind the polyphase resampler's FIR filters.
+
+    getBestKernels() picks the widest implementation the CPU supports (AVX-512,
+    AVX2 + FMA, SSE2) the first time it's called. The scalar fallback evaluates
+    the same polynomial approximations, so every variant agrees with the others
+    to within a few 1e-6 radians.
+
+    Every array passed to a kernel must hold getPaddedBinCount (numBins) floats.
+    The padding is processed as well, so keep it zeroed.
+
+    This header is deliberately free of JUCE so it can be included by the
+    translation units that are compiled with ISA-specific flags.
+*/
+namespace SpectralKernels
+{
+    /** Widest vector (in floats) of any compiled-in implementation. */
+    constexpr int maxVectorWidth = 16;
+
+    constexpr int getPaddedBinCount (int numBins) noexcept
+    {
+        return (numBins + maxVectorWidth - 1) & ~(maxVectorWidth - 1);
+    }
+
+    struct KernelTable
+    {
+        const char* name;
+
+        /** Cartesian to polar, then the true frequency of each bin (in bins) from
+            its phase advance since the previous frame. expectedPhase[k] holds the
+            advance of bin k's centre frequency over one hop, wrapped to +/-pi.
+        */
+        void (*analyse) (const float* real, const float* imag, const float* expectedPhase,
+                         float* lastPhase, float* magnitude, float* frequency,
+                         int numBins, float binsPerRadian) noexcept;
+
+        /** Advances each bin's running phase by its frequency (in bins) over one
+            hop, then converts back from polar to cartesian.
+        */
+        void (*synthesise) (const float* magnitude, const float* frequency, const float* expectedPhase,
+                            float* sumPhase, float* real, float* imag,
+                            int numBins, float radiansPerBin) noexcept;
+
+        /** Sum of a[i] * b[i] over numTaps floats; numTaps must be a multiple of
+            maxVectorWidth.
+        */
+        float (*dotProduct) (const float* a, const float* b, int numTaps) noexcept;
+    };
+
+    enum class InstructionSet
+    {
+        scalar,
+        sse2,
+        avx2,
+        avx512
+    };
+
+    /** Returns the implementation for one instruction set, or nullptr if it wasn't
+        compiled in or this CPU can't run it.
+    */
+    const KernelTable* getKernels (InstructionSet) noexcept;
+
+    /** Returns the fastest implementation available on this machine. */
+    const KernelTable& getBestKernels() noexcept;
+}
@@ -0,0 +1,47 @@
+#include "SpectralKernelsImpl.h"
+
+// Built with AVX2/FMA flags on x86 (see CMakeLists.txt); only called once the
+// dispatcher has checked the CPU supports them
+#if defined (__AVX2__) && (defined (__FMA__) || defined (_MSC_VER))
+
+#include <immintrin.h>
+
+namespace
+{
+    struct AVX2Ops
+    {
+        using Reg  = __m256;
+        using Mask = __m256;
+        static constexpr int width = 8;
+
+        static Reg load (const float* p) noexcept                 { return _mm256_loadu_ps (p); }
+        static void store (float* p, Reg v) noexcept              { _mm256_storeu_ps (p, v); }
+        static Reg set (float v) noexcept                         { return _mm256_set1_ps (v); }
+        static Reg ramp (float s) noexcept                        { return _mm256_add_ps (_mm256_set1_ps (s), _mm256_setr_ps (0, 1, 2, 3, 4, 5, 6, 7)); }
+        static Reg add (Reg a, Reg b) noexcept                    { return _mm256_add_ps (a, b); }
+        static Reg sub (Reg a, Reg b) noexcept                    { return _mm256_sub_ps (a, b); }
+        static Reg mul (Reg a, Reg b) noexcept                    { return _mm256_mul_ps (a, b); }
+        static Reg mulAdd (Reg a, Reg b, Reg c) noexcept          { return _mm256_fmadd_ps (a, b, c); }
+        static Reg div (Reg a, Reg b) noexcept                    { return _mm256_div_ps (a, b); }
+        static Reg sqrt (Reg a) noexcept                          { return _mm256_sqrt_ps (a); }
+        static Reg abs (Reg a) noexcept                           { return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a); }
+        static Reg min (Reg a, Reg b) noexcept                    { return _mm256_min_ps (a, b); }
+        static Reg max (Reg a, Reg b) noexcept                    { return _mm256_max_ps (a, b); }
+        static Reg round (Reg a) noexcept                         { return _mm256_round_ps (a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Mask lessThan (Reg a, Reg b) noexcept              { return _mm256_cmp_ps (a, b, _CMP_LT_OQ); }
+        static Mask greaterThan (Reg a, Reg b) noexcept           { return _mm256_cmp_ps (a, b, _CMP_GT_OQ); }
+        static Reg select (Mask m, Reg a, Reg b) noexcept         { return _mm256_blendv_ps (b, a, m); }
+    };
+}
+
+const SpectralKernels::KernelTable* SpectralKernels::getAVX2Kernels() noexcept
+{
+    static const auto table = SpectralKernelsImpl<AVX2Ops>::makeTable ("AVX2");
+    return &table;
+}
+
+#else
+
+const SpectralKernels::KernelTable* SpectralKernels::getAVX2Kernels() noexcept    { return nullptr; }
+
+#endif
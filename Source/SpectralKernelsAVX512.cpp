@@ -0,0 +1,47 @@
+#include "SpectralKernelsImpl.h"
+
+// Built with AVX-512F flags on x86 (see CMakeLists.txt); only called once the
+// dispatcher has checked the CPU supports them
+#if defined (__AVX512F__)
+
+#include <immintrin.h>
+
+namespace
+{
+    struct AVX512Ops
+    {
+        using Reg  = __m512;
+        using Mask = __mmask16;
+        static constexpr int width = 16;
+
+        static Reg load (const float* p) noexcept                 { return _mm512_loadu_ps (p); }
+        static void store (float* p, Reg v) noexcept              { _mm512_storeu_ps (p, v); }
+        static Reg set (float v) noexcept                         { return _mm512_set1_ps (v); }
+        static Reg ramp (float s) noexcept                        { return _mm512_add_ps (_mm512_set1_ps (s), _mm512_setr_ps (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)); }
+        static Reg add (Reg a, Reg b) noexcept                    { return _mm512_add_ps (a, b); }
+        static Reg sub (Reg a, Reg b) noexcept                    { return _mm512_sub_ps (a, b); }
+        static Reg mul (Reg a, Reg b) noexcept                    { return _mm512_mul_ps (a, b); }
+        static Reg mulAdd (Reg a, Reg b, Reg c) noexcept          { return _mm512_fmadd_ps (a, b, c); }
+        static Reg div (Reg a, Reg b) noexcept                    { return _mm512_div_ps (a, b); }
+        static Reg sqrt (Reg a) noexcept                          { return _mm512_sqrt_ps (a); }
+        static Reg abs (Reg a) noexcept                           { return _mm512_abs_ps (a); }
+        static Reg min (Reg a, Reg b) noexcept                    { return _mm512_min_ps (a, b); }
+        static Reg max (Reg a, Reg b) noexcept                    { return _mm512_max_ps (a, b); }
+        static Reg round (Reg a) noexcept                         { return _mm512_roundscale_ps (a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Mask lessThan (Reg a, Reg b) noexcept              { return _mm512_cmp_ps_mask (a, b, _CMP_LT_OQ); }
+        static Mask greaterThan (Reg a, Reg b) noexcept           { return _mm512_cmp_ps_mask (a, b, _CMP_GT_OQ); }
+        static Reg select (Mask m, Reg a, Reg b) noexcept         { return _mm512_mask_blend_ps (m, b, a); }
+    };
+}
+
+const SpectralKernels::KernelTable* SpectralKernels::getAVX512Kernels() noexcept
+{
+    static const auto table = SpectralKernelsImpl<AVX512Ops>::makeTable ("AVX-512");
+    return &table;
+}
+
+#else
+
+const SpectralKernels::KernelTable* SpectralKernels::getAVX512Kernels() noexcept  { return nullptr; }
+
+#endif
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "SpectralKernels.h"
+
+// Shared body of every SpectralKernels implementation. Each translation unit
+// instantiates it with its own vector operations, inside an anonymous namespace,
+// so code built with AVX flags can never be merged into the baseline build.
+//
+// An Ops type provides:  Reg, Mask, width, load, store, set, ramp, add, sub, mul,
+// mulAdd (a * b + c), div, sqrt, abs, min, max, round (to nearest), lessThan,
+// greaterThan and select (mask ? a : b).
+
+namespace SpectralKernels
+{
+    const KernelTable* getSSE2Kernels() noexcept;
+    const KernelTable* getAVX2Kernels() noexcept;
+    const KernelTable* getAVX512Kernels() noexcept;
+}
+
+namespace
+{
+
+template <typename Ops>
+struct SpectralKernelsImpl
+{
+    using Reg = typename Ops::Reg;
+
+    static constexpr float pi      = 3.14159265358979323846f;
+    static constexpr float halfPi  = 1.57079632679489661923f;
+    static constexpr float twoPi   = 6.28318530717958647692f;
+
+    static inline Reg wrapPhase (Reg phase) noexcept
+    {
+        const auto turns = Ops::round (Ops::mul (phase, Ops::set (1.0f / twoPi)));
+        return Ops::mulAdd (turns, Ops::set (-twoPi), phase);
+    }
+
+    // atan on [0, 1] as an odd minimax polynomial, then folded out to all four quadrants
+    static inline Reg atan2 (Reg y, Reg x) noexcept
+    {
+        const auto zero = Ops::set (0.0f);
+        const auto ax = Ops::abs (x);
+        const auto ay = Ops::abs (y);
+
+        const auto a = Ops::div (Ops::min (ax, ay), Ops::max (Ops::max (ax, ay), Ops::set (1.0e-30f)));
+        const auto s = Ops::mul (a, a);
+
+        auto r = Ops::set (-0.01172120f);
+        r = Ops::mulAdd (r, s, Ops::set ( 0.05265332f));
+        r = Ops::mulAdd (r, s, Ops::set (-0.11643287f));
+        r = Ops::mulAdd (r, s, Ops::set ( 0.19354346f));
+        r = Ops::mulAdd (r, s, Ops::set (-0.33262347f));
+        r = Ops::mulAdd (r, s, Ops::set ( 0.99997726f));
+        r = Ops::mul (r, a);
+
+        r = Ops::select (Ops::greaterThan (ay, ax), Ops::sub (Ops::set (halfPi), r), r);
+        r = Ops::select (Ops::lessThan (x, zero), Ops::sub (Ops::set (pi), r), r);
+        return Ops::select (Ops::lessThan (y, zero), Ops::sub (zero, r), r);
+    }
+
+    // Valid for |x| <= pi: folds into [-pi/2, pi/2] using sin (pi - x) = sin x and
+    // cos (pi - x) = -cos x, then evaluates the Taylor series to x^11 / x^12
+    static inline void sinCos (Reg x, Reg& sinOut, Reg& cosOut) noexcept
+    {
+        const auto above = Ops::greaterThan (x, Ops::set (halfPi));
+        const auto below = Ops::lessThan (x, Ops::set (-halfPi));
+
+        const auto folded = Ops::select (above, Ops::sub (Ops::set (pi), x),
+                                         Ops::select (below, Ops::sub (Ops::set (-pi), x), x));
+        const auto cosSign = Ops::select (above, Ops::set (-1.0f),
+                                          Ops::select (below, Ops::set (-1.0f), Ops::set (1.0f)));
+        const auto x2 = Ops::mul (folded, folded);
+
+        auto s = Ops::set (-1.0f / 39916800.0f);
+        s = Ops::mulAdd (s, x2, Ops::set ( 1.0f / 362880.0f));
+        s = Ops::mulAdd (s, x2, Ops::set (-1.0f / 5040.0f));
+        s = Ops::mulAdd (s, x2, Ops::set ( 1.0f / 120.0f));
+        s = Ops::mulAdd (s, x2, Ops::set (-1.0f / 6.0f));
+        s = Ops::mulAdd (s, x2, Ops::set ( 1.0f));
+        sinOut = Ops::mul (s, folded);
+
+        auto c = Ops::set (1.0f / 479001600.0f);
+        c = Ops::mulAdd (c, x2, Ops::set (-1.0f / 3628800.0f));
+        c = Ops::mulAdd (c, x2, Ops::set ( 1.0f / 40320.0f));
+        c = Ops::mulAdd (c, x2, Ops::set (-1.0f / 720.0f));
+        c = Ops::mulAdd (c, x2, Ops::set ( 1.0f / 24.0f));
+        c = Ops::mulAdd (c, x2, Ops::set (-0.5f));
+        c = Ops::mulAdd (c, x2, Ops::set ( 1.0f));
+        cosOut = Ops::mul (c, cosSign);
+    }
+
+    //==============================================================================
+    static void analyse (const float* real, const float* imag, const float* expectedPhase,
+                         float* lastPhase, float* magnitude, float* frequency,
+                         int numBins, float binsPerRadian) noexcept
+    {
+        const auto scale = Ops::set (binsPerRadian);
+        const auto step  = Ops::set ((float) Ops::width);
+        auto index = Ops::ramp (0.0f);
+
+        for (int k = 0; k < numBins; k += Ops::width)
+        {
+            const auto re = Ops::load (real + k);
+            const auto im = Ops::load (imag + k);
+            const auto phase = atan2 (im, re);
+
+            const auto delta = Ops::sub (Ops::sub (phase, Ops::load (lastPhase + k)), Ops::load (expectedPhase + k));
+            Ops::store (lastPhase + k, phase);
+
+            Ops::store (magnitude + k, Ops::sqrt (Ops::mulAdd (re, re, Ops::mul (im, im))));
+            Ops::store (frequency + k, Ops::mulAdd (wrapPhase (delta), scale, index));
+
+            index = Ops::add (index, step);
+        }
+    }
+
+    static void synthesise (const float* magnitude, const float* frequency, const float* expectedPhase,
+                            float* sumPhase, float* real, float* imag,
+                            int numBins, float radiansPerBin) noexcept
+    {
+        const auto scale = Ops::set (radiansPerBin);
+        const auto step  = Ops::set ((float) Ops::width);
+        auto index = Ops::ramp (0.0f);
+
+        for (int k = 0; k < numBins; k += Ops::width)
+        {
+            // Advance by the bin centre's (pre-wrapped) phase step plus the small
+            // deviation from it, which keeps the sum precise at high bin numbers
+            const auto deviation = Ops::sub (Ops::load (frequency + k), index);
+            const auto advance = Ops::mulAdd (deviation, scale, Ops::load (expectedPhase + k));
+            const auto phase = wrapPhase (Ops::add (Ops::load (sumPhase + k), advance));
+            Ops::store (sumPhase + k, phase);
+
+            Reg s, c;
+            sinCos (phase, s, c);
+
+            const auto mag = Ops::load (magnitude + k);
+            Ops::store (real + k, Ops::mul (mag, c));
+            Ops::store (imag + k, Ops::mul (mag, s));
+
+            index = Ops::add (index, step);
+        }
+    }
+
+    static float dotProduct (const float* a, const float* b, int numTaps) noexcept
+    {
+        // Two accumulators, so consecutive multiply-adds don't wait on each other
+        auto sum0 = Ops::set (0.0f);
+        auto sum1 = Ops::set (0.0f);
+        int i = 0;
+
+        for (; i + 2 * Ops::width <= numTaps; i += 2 * Ops::width)
+        {
+            sum0 = Ops::mulAdd (Ops::load (a + i), Ops::load (b + i), sum0);
+            sum1 = Ops::mulAdd (Ops::load (a + i + Ops::width), Ops::load (b + i + Ops::width), sum1);
+        }
+
+        for (; i < numTaps; i += Ops::width)
+            sum0 = Ops::mulAdd (Ops::load (a + i), Ops::load (b + i), sum0);
+
+        float lanes[Ops::width];
+        Ops::store (lanes, Ops::add (sum0, sum1));
+
+        float total = 0.0f;
+
+        for (int j = 0; j < Ops::width; ++j)
+            total += lanes[j];
+
+        return total;
+    }
+
+    static SpectralKernels::KernelTable makeTable (const char* name) noexcept
+    {
+        return { name, analyse, synthesise, dotProduct };
+    }
+};
+
+} // namespace
@@ -0,0 +1,45 @@
+#include "SpectralKernelsImpl.h"
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+namespace
+{
+    struct SSE2Ops
+    {
+        using Reg  = __m128;
+        using Mask = __m128;
+        static constexpr int width = 4;
+
+        static Reg load (const float* p) noexcept                 { return _mm_loadu_ps (p); }
+        static void store (float* p, Reg v) noexcept              { _mm_storeu_ps (p, v); }
+        static Reg set (float v) noexcept                         { return _mm_set1_ps (v); }
+        static Reg ramp (float s) noexcept                        { return _mm_setr_ps (s, s + 1.0f, s + 2.0f, s + 3.0f); }
+        static Reg add (Reg a, Reg b) noexcept                    { return _mm_add_ps (a, b); }
+        static Reg sub (Reg a, Reg b) noexcept                    { return _mm_sub_ps (a, b); }
+        static Reg mul (Reg a, Reg b) noexcept                    { return _mm_mul_ps (a, b); }
+        static Reg mulAdd (Reg a, Reg b, Reg c) noexcept          { return _mm_add_ps (_mm_mul_ps (a, b), c); }
+        static Reg div (Reg a, Reg b) noexcept                    { return _mm_div_ps (a, b); }
+        static Reg sqrt (Reg a) noexcept                          { return _mm_sqrt_ps (a); }
+        static Reg abs (Reg a) noexcept                           { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a); }
+        static Reg min (Reg a, Reg b) noexcept                    { return _mm_min_ps (a, b); }
+        static Reg max (Reg a, Reg b) noexcept                    { return _mm_max_ps (a, b); }
+        static Reg round (Reg a) noexcept                         { return _mm_cvtepi32_ps (_mm_cvtps_epi32 (a)); }
+        static Mask lessThan (Reg a, Reg b) noexcept              { return _mm_cmplt_ps (a, b); }
+        static Mask greaterThan (Reg a, Reg b) noexcept           { return _mm_cmpgt_ps (a, b); }
+        static Reg select (Mask m, Reg a, Reg b) noexcept         { return _mm_or_ps (_mm_and_ps (m, a), _mm_andnot_ps (m, b)); }
+    };
+}
+
+const SpectralKernels::KernelTable* SpectralKernels::getSSE2Kernels() noexcept
+{
+    static const auto table = SpectralKernelsImpl<SSE2Ops>::makeTable ("SSE2");
+    return &table;
+}
+
+#else
+
+const SpectralKernels::KernelTable* SpectralKernels::getSSE2Kernels() noexcept    { return nullptr; }
+
+#endif
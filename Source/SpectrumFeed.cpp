@@ -0,0 +1,73 @@
+#include "SpectrumFeed.h"
+
+//==============================================================================
+void SpectrumFeed::prepare (double newSampleRate) noexcept
+{
+    sampleRate.store ((float) newSampleRate, std::memory_order_relaxed);
+    samplesPerFrame = juce::jmax (1, juce::roundToInt (newSampleRate / framesPerSecond));
+    samplesUntilFrame = 0;
+}
+
+bool SpectrumFeed::readLatest (Frame& destination) noexcept
+{
+    const auto written = numWritten.load (std::memory_order_acquire);
+    const auto read = numRead.load (std::memory_order_relaxed);
+
+    if (written == read)
+        return false;
+
+    destination = slots[(written - 1) % numSlots];
+    numRead.store (written, std::memory_order_release);
+    return true;
+}
+
+//==============================================================================
+SpectrumFeed::Frame* SpectrumFeed::startFrame (int numSamplesAdvanced) noexcept
+{
+    if (numViewers.load (std::memory_order_relaxed) <= 0)
+        return nullptr;
+
+    samplesUntilFrame -= numSamplesAdvanced;
+
+    if (samplesUntilFrame > 0)
+        return nullptr;
+
+    // Keep the slot the editor may be copying (the newest unread one) untouched
+    const auto written = numWritten.load (std::memory_order_relaxed);
+
+    if (written - numRead.load (std::memory_order_acquire) >= (juce::uint32) numSlots - 1)
+        return nullptr;
+
+    samplesUntilFrame += samplesPerFrame;
+    samplesUntilFrame = juce::jmax (samplesUntilFrame, 1);
+    return &slots[written % numSlots];
+}
+
+void SpectrumFeed::writeBands (float* bands, const float* real, const float* imag, int numBins, float binHz, float gain) const noexcept
+{
+    // Each band takes the loudest bin between its edges; bands narrower than a bin
+    // (at the bottom of short frames) take the bin their lower edge falls in
+    const auto maxFrequency = getMaxFrequency();
+    const auto bandRatio = std::pow (maxFrequency / minFrequency, 1.0f / (float) numBands);
+    auto edge = minFrequency;
+    auto firstBin = juce::jlimit (0, numBins - 1, (int) (edge / binHz));
+
+    for (int b = 0; b < numBands; ++b)
+    {
+        edge *= bandRatio;
+        const auto lastBin = juce::jlimit (firstBin, numBins - 1, (int) (edge / binHz));
+
+        float peak = 0.0f;
+
+        for (int k = firstBin; k <= lastBin; ++k)
+            peak = juce::jmax (peak, real[k] * real[k] + imag[k] * imag[k]);
+
+        bands[b] = std::sqrt (peak) * gain;
+        firstBin = juce::jmin (lastBin + 1, numBins - 1);
+    }
+}
+
+void SpectrumFeed::finishFrame() noexcept
+{
+    numWritten.fetch_add (1, std::memory_order_release);
+}
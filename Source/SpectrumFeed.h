@@ -0,0 +1,78 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Single-producer, single-consumer feed of spectrum frames from the audio
+    thread to the editor.
+
+    The phase vocoder writes the input and output magnitudes of one channel into
+    a frame, reduced to numBands log-spaced bands, at most framesPerSecond times
+    a second. Frames go through a fixed ring of slots with atomic read and write
+    counters, so neither side ever waits or allocates; when the editor falls
+    behind, new frames are dropped rather than overwriting one being read.
+
+    Nothing is written unless a viewer is attached, so with the editor closed
+    each vocoder frame costs one relaxed atomic load.
+*/
+class SpectrumFeed
+{
+public:
+    //==============================================================================
+    static constexpr int numBands = 128;
+    static constexpr int numSlots = 8;
+    static constexpr double framesPerSecond = 60.0;
+    static constexpr float minFrequency = 20.0f;
+
+    /** Linear amplitudes (1 is a full-scale sine) of each band. */
+    struct Frame
+    {
+        float input[numBands];
+        float output[numBands];
+    };
+
+    SpectrumFeed() = default;
+
+    /** Sets the rate used to space frames and place bands. Not realtime-safe. */
+    void prepare (double sampleRate) noexcept;
+
+    //==============================================================================
+    /** Top of the highest band: the Nyquist frequency of the prepared rate. */
+    float getMaxFrequency() const noexcept              { return 0.5f * sampleRate.load (std::memory_order_relaxed); }
+
+    /** Editor side: frames are only produced while at least one viewer is attached. */
+    void addViewer() noexcept                           { numViewers.fetch_add (1, std::memory_order_relaxed); }
+    void removeViewer() noexcept                        { numViewers.fetch_sub (1, std::memory_order_relaxed); }
+
+    /** Editor side: copies the newest frame into destination and returns true if
+        any arrived since the last call. Older pending frames are skipped.
+    */
+    bool readLatest (Frame& destination) noexcept;
+
+    //==============================================================================
+    /** Audio side: called once per vocoder frame with the samples it advanced by.
+        Returns a slot to fill when a frame is due and a viewer is attached, or
+        nullptr; a returned slot must be handed back with finishFrame().
+    */
+    Frame* startFrame (int numSamplesAdvanced) noexcept;
+
+    /** Audio side: reduces a spectrum of numBins bins (each binHz wide, scaled so a
+        full-scale sine reads 1 after multiplying by gain) to bands.
+    */
+    void writeBands (float* bands, const float* real, const float* imag, int numBins, float binHz, float gain) const noexcept;
+
+    /** Audio side: publishes the frame returned by startFrame(). */
+    void finishFrame() noexcept;
+
+private:
+    //==============================================================================
+    std::array<Frame, numSlots> slots {};
+    std::atomic<juce::uint32> numWritten { 0 }, numRead { 0 };
+    std::atomic<int> numViewers { 0 };
+
+    std::atomic<float> sampleRate { 44100.0f };
+    int samplesPerFrame = 735, samplesUntilFrame = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumFeed)
+};
@@ -0,0 +1,169 @@
+#include "SpectrumView.h"
+
+//==============================================================================
+SpectrumView::SpectrumView (SpectrumFeed& feedToShow)
+    : feed (feedToShow)
+{
+    inputDecibels.fill (minDecibels);
+    outputDecibels.fill (minDecibels);
+
+    setOpaque (true);
+    feed.addViewer();
+    startTimerHz (refreshRateHz);
+}
+
+SpectrumView::~SpectrumView()
+{
+    stopTimer();
+    feed.removeViewer();
+}
+
+//==============================================================================
+void SpectrumView::timerCallback()
+{
+    const auto fall = fallDecibelsPerSecond / (float) refreshRateHz;
+    const auto gotFrame = feed.readLatest (frame);
+
+    if (gotFrame)
+        ticksSinceFrame = 0;
+    else
+        ++ticksSinceFrame;
+
+    // Once the levels have fallen to the floor there is nothing left to redraw
+    const auto isSettled = ! gotFrame && ticksSinceFrame > refreshRateHz * (int) ((maxDecibels - minDecibels) / fallDecibelsPerSecond + 1.0f);
+
+    if (isSettled && feed.getMaxFrequency() == gridMaxFrequency)
+        return;
+
+    for (int b = 0; b < SpectrumFeed::numBands; ++b)
+    {
+        auto update = [gotFrame, fall] (float& level, float amplitude)
+        {
+            const auto fresh = gotFrame ? juce::Decibels::gainToDecibels (amplitude, minDecibels) : minDecibels;
+            level = juce::jlimit (minDecibels, maxDecibels, juce::jmax (fresh, level - fall));
+        };
+
+        update (inputDecibels[(size_t) b], frame.input[b]);
+        update (outputDecibels[(size_t) b], frame.output[b]);
+    }
+
+    if (feed.getMaxFrequency() != gridMaxFrequency)
+        drawGrid();
+
+    updatePaths();
+    repaint();
+}
+
+float SpectrumView::getXForFrequency (float frequency) const noexcept
+{
+    const auto maxFrequency = juce::jmax (SpectrumFeed::minFrequency * 2.0f, gridMaxFrequency);
+
+    return (float) getWidth() * std::log (frequency / SpectrumFeed::minFrequency)
+                              / std::log (maxFrequency / SpectrumFeed::minFrequency);
+}
+
+void SpectrumView::updatePaths()
+{
+    const auto width = (float) getWidth();
+    const auto height = (float) getHeight();
+
+    auto toY = [height] (float decibels)
+    {
+        return juce::jmap (decibels, minDecibels, maxDecibels, height, 0.0f);
+    };
+
+    // Bands are evenly spaced in log frequency, as is the x axis
+    auto buildPath = [&] (juce::Path& path, const std::array<float, SpectrumFeed::numBands>& levels, bool closed)
+    {
+        path.clear();
+        path.preallocateSpace (3 * (SpectrumFeed::numBands + 3));
+
+        for (int b = 0; b < SpectrumFeed::numBands; ++b)
+        {
+            const auto x = width * ((float) b + 0.5f) / (float) SpectrumFeed::numBands;
+
+            if (b == 0)
+                path.startNewSubPath (closed ? 0.0f : x, closed ? height : toY (levels[0]));
+
+            path.lineTo (x, toY (levels[(size_t) b]));
+        }
+
+        if (closed)
+        {
+            path.lineTo (width, height);
+            path.closeSubPath();
+        }
+    };
+
+    buildPath (outputPath, outputDecibels, true);
+    buildPath (inputPath, inputDecibels, false);
+}
+
+//==============================================================================
+void SpectrumView::drawGrid()
+{
+    gridMaxFrequency = feed.getMaxFrequency();
+
+    if (getWidth() <= 0 || getHeight() <= 0)
+        return;
+
+    grid = juce::Image (juce::Image::RGB, getWidth(), getHeight(), true);
+    juce::Graphics g (grid);
+
+    g.fillAll (juce::Colour (0xff141414));
+    g.setFont (juce::Font (10.0f));
+
+    for (auto frequency : { 100.0f, 1000.0f, 10000.0f })
+    {
+        if (frequency >= gridMaxFrequency)
+            continue;
+
+        const auto x = getXForFrequency (frequency);
+        g.setColour (juce::Colour (0xff2a2a2a));
+        g.drawVerticalLine (juce::roundToInt (x), 0.0f, (float) getHeight());
+
+        g.setColour (juce::Colour (0xff6a6a6a));
+        g.drawText (frequency >= 1000.0f ? juce::String ((int) frequency / 1000) + "k" : juce::String ((int) frequency),
+                    juce::roundToInt (x) + 2, getHeight() - 14, 30, 12, juce::Justification::left);
+    }
+
+    for (auto decibels = maxDecibels - 24.0f; decibels > minDecibels; decibels -= 24.0f)
+    {
+        const auto y = juce::jmap (decibels, minDecibels, maxDecibels, (float) getHeight(), 0.0f);
+        g.setColour (juce::Colour (0xff2a2a2a));
+        g.drawHorizontalLine (juce::roundToInt (y), 0.0f, (float) getWidth());
+    }
+}
+
+void SpectrumView::resized()
+{
+    drawGrid();
+    updatePaths();
+}
+
+void SpectrumView::paint (juce::Graphics& g)
+{
+    if (grid.isValid())
+        g.drawImageAt (grid, 0, 0);
+    else
+        g.fillAll (juce::Colour (0xff141414));
+
+    // Shifted output filled, input as an outline on top
+    g.setColour (juce::Colour (0x6642a2c8));
+    g.fillPath (outputPath);
+
+    g.setColour (juce::Colours::white.withAlpha (0.7f));
+    g.strokePath (inputPath, juce::PathStrokeType (1.0f));
+
+    if (ticksSinceFrame > refreshRateHz / 2)
+    {
+        g.setColour (juce::Colour (0xff6a6a6a));
+        g.setFont (juce::Font (12.0f));
+        // Stopped, passing audio straight through, or in the time-domain low-latency engine
+        g.drawText ("No spectrum from the phase vocoder",
+                    getLocalBounds(), juce::Justification::centred, true);
+    }
+
+    g.setColour (juce::Colour (0xff3a3a3a));
+    g.drawRect (getLocalBounds(), 1);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumFeed.h"
+
+//==============================================================================
+/**
+    Draws the input and shifted output spectra from a SpectrumFeed.
+
+    A timer polls the feed refreshRateHz times a second. The paths are only
+    rebuilt and repainted when a frame has arrived (or while the levels are
+    falling back after the feed stops), and the grid is drawn once into a
+    cached image, so a repaint costs two paths and an image blit. The view is
+    attached to the feed for as long as it exists, which is what makes the
+    audio thread produce frames.
+*/
+class SpectrumView  : public juce::Component,
+                      private juce::Timer
+{
+public:
+    explicit SpectrumView (SpectrumFeed&);
+    ~SpectrumView() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+    static constexpr int refreshRateHz = 60;
+    static constexpr float minDecibels = -96.0f, maxDecibels = 0.0f;
+
+    /** How fast a band falls when its level drops, so peaks stay readable. */
+    static constexpr float fallDecibelsPerSecond = 60.0f;
+
+private:
+    //==============================================================================
+    void timerCallback() override;
+    void updatePaths();
+    void drawGrid();
+    float getXForFrequency (float frequency) const noexcept;
+
+    SpectrumFeed& feed;
+    SpectrumFeed::Frame frame {};
+    std::array<float, SpectrumFeed::numBands> inputDecibels, outputDecibels;
+
+    juce::Path inputPath, outputPath;
+    juce::Image grid;
+    float gridMaxFrequency = 0.0f;
+    int ticksSinceFrame = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumView)
+};
@@ -0,0 +1,196 @@
+#include "StageProfiler.h"
+
+//==============================================================================
+const char* StageProfiler::getStageName (Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::block:          return "block";
+        case Stage::inputFifo:      return "inputFifo";
+        case Stage::analysisFft:    return "analysisFft";
+        case Stage::binProcessing:  return "binProcessing";
+        case Stage::formant:        return "formant";
+        case Stage::synthesis:      return "synthesis";
+        case Stage::wsola:          return "wsola";
+        case Stage::mixing:         return "mixing";
+        case Stage::resampling:     return "resampling";
+    }
+
+    return "";
+}
+
+//==============================================================================
+StageProfiler::StageProfiler()
+{
+    reset();
+}
+
+void StageProfiler::record (Stage stage, juce::uint64 nanoseconds) noexcept
+{
+    auto& histogram = histograms[(size_t) stage];
+
+    const auto bucket = nanoseconds == 0 ? 0 : juce::findHighestSetBit ((juce::uint32) juce::jmin (nanoseconds, (juce::uint64) 0xffffffffu));
+
+    histogram.count.fetch_add (1, std::memory_order_relaxed);
+    histogram.totalNanoseconds.fetch_add (nanoseconds, std::memory_order_relaxed);
+    histogram.buckets[(size_t) bucket].fetch_add (1, std::memory_order_relaxed);
+
+    auto previousMax = histogram.maxNanoseconds.load (std::memory_order_relaxed);
+
+    while (nanoseconds > previousMax
+           && ! histogram.maxNanoseconds.compare_exchange_weak (previousMax, nanoseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+StageProfiler::Snapshot StageProfiler::getSnapshot() const noexcept
+{
+    Snapshot snapshot;
+
+    for (size_t s = 0; s < histograms.size(); ++s)
+    {
+        const auto& histogram = histograms[s];
+        auto& times = snapshot.stages[s];
+
+        times.count = histogram.count.load (std::memory_order_relaxed);
+        times.totalNanoseconds = histogram.totalNanoseconds.load (std::memory_order_relaxed);
+        times.maxNanoseconds = histogram.maxNanoseconds.load (std::memory_order_relaxed);
+
+        for (size_t b = 0; b < histogram.buckets.size(); ++b)
+            times.buckets[b] = histogram.buckets[b].load (std::memory_order_relaxed);
+    }
+
+    snapshot.numSamples = numSamples.load (std::memory_order_relaxed);
+    snapshot.sampleRate = rate.load (std::memory_order_relaxed);
+    return snapshot;
+}
+
+void StageProfiler::reset() noexcept
+{
+    for (auto& histogram : histograms)
+    {
+        histogram.count.store (0, std::memory_order_relaxed);
+        histogram.totalNanoseconds.store (0, std::memory_order_relaxed);
+        histogram.maxNanoseconds.store (0, std::memory_order_relaxed);
+
+        for (auto& bucket : histogram.buckets)
+            bucket.store (0, std::memory_order_relaxed);
+    }
+
+    numSamples.store (0, std::memory_order_relaxed);
+}
+
+//==============================================================================
+double StageProfiler::Snapshot::StageTimes::getMeanMicroseconds() const noexcept
+{
+    return count > 0 ? (double) totalNanoseconds * 1.0e-3 / (double) count : 0.0;
+}
+
+double StageProfiler::Snapshot::StageTimes::getPercentileMicroseconds (double fraction) const noexcept
+{
+    if (count == 0)
+        return 0.0;
+
+    const auto wanted = (juce::uint64) std::ceil (juce::jlimit (0.0, 1.0, fraction) * (double) count);
+    juce::uint64 seen = 0;
+
+    for (size_t b = 0; b < buckets.size(); ++b)
+    {
+        seen += buckets[b];
+
+        if (seen >= juce::jmax ((juce::uint64) 1, wanted))
+        {
+            const auto upperEdge = (double) ((juce::uint64) 1 << (b + 1));
+            return juce::jmin (upperEdge, (double) juce::jmax (maxNanoseconds, (juce::uint64) 1)) * 1.0e-3;
+        }
+    }
+
+    return (double) maxNanoseconds * 1.0e-3;
+}
+
+double StageProfiler::Snapshot::getLoadPercent (Stage stage) const noexcept
+{
+    if (numSamples == 0 || sampleRate <= 0.0)
+        return 0.0;
+
+    const auto audioNanoseconds = (double) numSamples / sampleRate * 1.0e9;
+    return 100.0 * (double) (*this)[stage].totalNanoseconds / audioNanoseconds;
+}
+
+StageProfiler::Snapshot& StageProfiler::Snapshot::operator+= (const Snapshot& other) noexcept
+{
+    for (size_t s = 0; s < stages.size(); ++s)
+    {
+        auto& times = stages[s];
+        const auto& more = other.stages[s];
+
+        times.count += more.count;
+        times.totalNanoseconds += more.totalNanoseconds;
+        times.maxNanoseconds = juce::jmax (times.maxNanoseconds, more.maxNanoseconds);
+
+        for (size_t b = 0; b < times.buckets.size(); ++b)
+            times.buckets[b] += more.buckets[b];
+    }
+
+    numSamples += other.numSamples;
+
+    if (sampleRate <= 0.0)
+        sampleRate = other.sampleRate;
+
+    return *this;
+}
+
+StageProfiler::Snapshot StageProfiler::Snapshot::operator- (const Snapshot& earlier) const noexcept
+{
+    auto difference = *this;
+
+    for (size_t s = 0; s < stages.size(); ++s)
+    {
+        auto& times = difference.stages[s];
+        const auto& before = earlier.stages[s];
+
+        times.count -= juce::jmin (times.count, before.count);
+        times.totalNanoseconds -= juce::jmin (times.totalNanoseconds, before.totalNanoseconds);
+
+        for (size_t b = 0; b < times.buckets.size(); ++b)
+            times.buckets[b] -= juce::jmin (times.buckets[b], before.buckets[b]);
+    }
+
+    difference.numSamples -= juce::jmin (numSamples, earlier.numSamples);
+    return difference;
+}
+
+juce::var StageProfiler::Snapshot::toJson() const
+{
+    auto* stagesObject = new juce::DynamicObject();
+
+    for (int s = 0; s < numStages; ++s)
+    {
+        const auto stage = (Stage) s;
+        const auto& times = (*this)[stage];
+
+        juce::Array<juce::var> histogram;
+
+        for (auto bucket : times.buckets)
+            histogram.add ((juce::int64) bucket);
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("count", (juce::int64) times.count);
+        object->setProperty ("totalUs", (double) times.totalNanoseconds * 1.0e-3);
+        object->setProperty ("meanUs", times.getMeanMicroseconds());
+        object->setProperty ("p50Us", times.getPercentileMicroseconds (0.5));
+        object->setProperty ("p99Us", times.getPercentileMicroseconds (0.99));
+        object->setProperty ("maxUs", (double) times.maxNanoseconds * 1.0e-3);
+        object->setProperty ("loadPercent", getLoadPercent (stage));
+        object->setProperty ("histogramLog2Ns", histogram);
+
+        stagesObject->setProperty (getStageName (stage), juce::var (object));
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty ("samples", (juce::int64) numSamples);
+    report->setProperty ("sampleRate", sampleRate);
+    report->setProperty ("audioSeconds", sampleRate > 0.0 ? (double) numSamples / sampleRate : 0.0);
+    report->setProperty ("stages", juce::var (stagesObject));
+    return juce::var (report);
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef PITCHMORPHER_PROFILING
+ #define PITCHMORPHER_PROFILING 0
+#endif
+
+//==============================================================================
+/**
+    Lock-free timing histograms for each stage of the audio path.
+
+    Stages are timed with std::chrono::steady_clock by ScopedTimers placed with
+    PITCHMORPHER_PROFILE_STAGE, and each measurement lands in a histogram of
+    power-of-two nanosecond buckets through relaxed atomic adds, so worker
+    threads can record alongside the audio thread and readers never block
+    either. Readers take a Snapshot; the difference of two snapshots gives the
+    figures for the time between them.
+
+    Profiling is compiled in with PITCHMORPHER_PROFILING=1. Otherwise the macro
+    expands to nothing and no stage is ever timed.
+*/
+class StageProfiler
+{
+public:
+    //==============================================================================
+    enum class Stage
+    {
+        block,          // the whole of processBlock
+        inputFifo,      // copying samples in and out of the vocoder's rings
+        analysisFft,    // windowing, forward transform, magnitude and frequency
+        binProcessing,  // transient detection, bin remapping and phase handling
+        formant,        // envelope estimation and formant gains
+        synthesis,      // phase accumulation, inverse transform and overlap-add
+        wsola,          // the whole low-latency engine
+        mixing,         // dry copy and wet/dry mix
+        resampling      // to and from the fixed internal rate
+    };
+
+    static constexpr int numStages = 9;
+
+    /** Bucket i counts times in [2^i, 2^(i+1)) ns; the last one also takes anything longer. */
+    static constexpr int numBuckets = 32;
+
+    static const char* getStageName (Stage) noexcept;
+
+    //==============================================================================
+    struct Snapshot
+    {
+        struct StageTimes
+        {
+            juce::uint64 count = 0, totalNanoseconds = 0, maxNanoseconds = 0;
+            std::array<juce::uint64, numBuckets> buckets {};
+
+            double getMeanMicroseconds() const noexcept;
+
+            /** Upper edge of the bucket holding the given fraction (0 to 1) of the times. */
+            double getPercentileMicroseconds (double fraction) const noexcept;
+        };
+
+        std::array<StageTimes, numStages> stages;
+        juce::uint64 numSamples = 0;
+        double sampleRate = 0.0;
+
+        const StageTimes& operator[] (Stage stage) const noexcept   { return stages[(size_t) stage]; }
+
+        /** Time spent in a stage as a share of the audio processed, i.e. of one core. */
+        double getLoadPercent (Stage) const noexcept;
+
+        /** Combines runs, e.g. of several processors. Maxima are kept, not summed. */
+        Snapshot& operator+= (const Snapshot&) noexcept;
+
+        /** What happened since an earlier snapshot of the same profiler. The
+            maximum is the overall one, since it can't be taken apart.
+        */
+        Snapshot operator- (const Snapshot& earlier) const noexcept;
+
+        juce::var toJson() const;
+    };
+
+    //==============================================================================
+    StageProfiler();
+
+    /** Sets the rate used to turn samples into audio time. */
+    void prepare (double sampleRate) noexcept       { rate.store (sampleRate, std::memory_order_relaxed); }
+
+    void record (Stage, juce::uint64 nanoseconds) noexcept;
+    void addSamples (int numNewSamples) noexcept    { numSamples.fetch_add ((juce::uint64) juce::jmax (0, numNewSamples), std::memory_order_relaxed); }
+
+    Snapshot getSnapshot() const noexcept;
+    void reset() noexcept;
+
+    //==============================================================================
+    /** Times its own lifetime into a stage; does nothing with a null profiler. */
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer (StageProfiler* profilerToUse, Stage stageToTime) noexcept
+            : profiler (profilerToUse), stage (stageToTime)
+        {
+            if (profiler != nullptr)
+                start = std::chrono::steady_clock::now();
+        }
+
+        ~ScopedTimer() noexcept
+        {
+            if (profiler != nullptr)
+                profiler->record (stage, (juce::uint64) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now() - start).count());
+        }
+
+    private:
+        StageProfiler* profiler;
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedTimer)
+    };
+
+private:
+    //==============================================================================
+    struct Histogram
+    {
+        std::atomic<juce::uint64> count { 0 }, totalNanoseconds { 0 }, maxNanoseconds { 0 };
+        std::array<std::atomic<juce::uint64>, numBuckets> buckets;
+    };
+
+    std::array<Histogram, numStages> histograms;
+    std::atomic<juce::uint64> numSamples { 0 };
+    std::atomic<double> rate { 44100.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageProfiler)
+};
+
+#if PITCHMORPHER_PROFILING
+ /** Times the rest of the enclosing scope into the given StageProfiler::Stage. */
+ #define PITCHMORPHER_PROFILE_STAGE(profiler, stageName) \
+    StageProfiler::ScopedTimer JUCE_JOIN_MACRO (stageTimer, __LINE__) (profiler, StageProfiler::Stage::stageName)
+#else
+ #define PITCHMORPHER_PROFILE_STAGE(profiler, stageName)
+#endif
@@ -0,0 +1,233 @@
+#include "WsolaShifter.h"
+
+//==============================================================================
+void WsolaShifter::prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena)
+{
+    lookahead = juce::jmax (8, juce::roundToInt (spec.sampleRate * lookaheadSeconds));
+    maxJump = lookahead;
+    minJump = juce::jmax (2, lookahead / 4);
+    correlationLength = juce::jmax (4, lookahead / 4);
+    defaultFadeLength = juce::jmax (2, lookahead / 4);
+
+    // The head is kept within half a maximum jump either side of the nominal delay
+    minDelay = lookahead - maxJump * 0.5;
+    maxDelay = lookahead + maxJump * 0.5;
+
+    // Room for the longest delay plus a crossfade's drift and a whole chunk of new input
+    ringSize = juce::nextPowerOfTwo ((int) maxDelay + defaultFadeLength + maxChunk + 8);
+    ringMask = ringSize - 1;
+
+    rings = arena.allocate<RealtimeArena::Array<float>> (spec.numChannels);
+    for (auto& ring : rings)
+        ring = arena.allocate<float> ((size_t) ringSize);
+
+    mixRing = arena.allocate<float> ((size_t) ringSize);
+
+    pitchRatio.reset (spec.sampleRate, pitchRampSeconds);
+    reset();
+}
+
+void WsolaShifter::reset() noexcept
+{
+    for (auto& ring : rings)
+        std::fill (ring.begin(), ring.end(), 0.0f);
+
+    std::fill (mixRing.begin(), mixRing.end(), 0.0f);
+
+    writePosition = 0;
+    delay = nextDelay = (double) lookahead;
+    fadePosition = fadeLength = 0;
+    fading = false;
+
+    pitchRatio.setCurrentAndTargetValue (pitchRatio.getTargetValue());
+}
+
+//==============================================================================
+int WsolaShifter::getSamplesUntilJump (double drift) const noexcept
+{
+    // drift is how much the delay changes per sample: negative when shifting up
+    if (drift < 0.0)
+        return (int) juce::jlimit (0.0, (double) maxChunk, std::ceil ((delay - minDelay) / -drift));
+
+    if (drift > 0.0)
+        return (int) juce::jlimit (0.0, (double) maxChunk, std::ceil ((maxDelay - delay) / drift));
+
+    // Unshifted: settle back onto the reported latency
+    return std::abs (delay - lookahead) >= 1.0 ? 0 : maxChunk;
+}
+
+void WsolaShifter::startJump (double drift) noexcept
+{
+    if (drift == 0.0)
+    {
+        nextDelay = (double) lookahead;
+    }
+    else
+    {
+        // Jump back in time when shifting up, forward when shifting down, by the
+        // lag whose waveform best continues what the current head is playing
+        const int direction = drift < 0.0 ? 1 : -1;
+        const auto* mix = mixRing.data();
+        const int reference = writePosition - juce::roundToInt (delay);
+
+        auto getScore = [&] (int lag)
+        {
+            const int candidate = writePosition - juce::roundToInt (delay + direction * lag);
+            float correlation = 0.0f, energy = 1.0e-9f;
+
+            for (int i = 0; i < correlationLength; ++i)
+            {
+                const auto c = mix[(candidate + i) & ringMask];
+                correlation += mix[(reference + i) & ringMask] * c;
+                energy += c * c;
+            }
+
+            return correlation / std::sqrt (energy);
+        };
+
+        // Coarse search on every other lag, then refine around the winner
+        int bestLag = minJump;
+        float bestScore = getScore (minJump);
+
+        for (int lag = minJump + 2; lag <= maxJump; lag += 2)
+        {
+            const auto score = getScore (lag);
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestLag = lag;
+            }
+        }
+
+        for (auto lag : { bestLag - 1, bestLag + 1 })
+        {
+            if (lag >= minJump && lag <= maxJump && getScore (lag) > bestScore)
+            {
+                bestScore = getScore (lag);
+                bestLag = lag;
+            }
+        }
+
+        nextDelay = delay + direction * bestLag;
+    }
+
+    fadeLength = defaultFadeLength;
+
+    // When shifting up both heads approach the write position; the outgoing one
+    // mustn't overtake it before the crossfade completes
+    if (drift < 0.0)
+        fadeLength = juce::jlimit (1, defaultFadeLength, (int) ((delay - 3.0) / -drift));
+
+    fadePosition = 0;
+    fading = true;
+}
+
+float WsolaShifter::readHermite (const float* ring, double position) const noexcept
+{
+    const auto index = (int) position;
+    const auto t = (float) (position - index);
+
+    const auto xm1 = ring[(index - 1) & ringMask];
+    const auto x0  = ring[index & ringMask];
+    const auto x1  = ring[(index + 1) & ringMask];
+    const auto x2  = ring[(index + 2) & ringMask];
+
+    const auto c1 = 0.5f * (x1 - xm1);
+    const auto c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+    const auto c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+    return ((c3 * t + c2) * t + c1) * t + x0;
+}
+
+//==============================================================================
+void WsolaShifter::process (float* const* channelData, int numChannels, int numSamples) noexcept
+{
+    jassert (numChannels <= (int) rings.size());
+
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        // The head speed is constant within a chunk; ramps are followed in short chunks
+        const auto ramping = pitchRatio.isSmoothing();
+        const auto ratio = (double) juce::jlimit (0.25f, 4.0f, pitchRatio.getCurrentValue());
+        const auto drift = 1.0 - ratio;
+
+        int numThisTime = juce::jmin (numSamples - done, ramping ? maxRampChunk : maxChunk);
+
+        if (! fading)
+        {
+            const auto untilJump = getSamplesUntilJump (drift);
+
+            if (untilJump == 0)
+                startJump (drift);
+            else
+                numThisTime = juce::jmin (numThisTime, untilJump);
+        }
+
+        if (fading)
+            numThisTime = juce::jmin (numThisTime, fadeLength - fadePosition);
+
+        // Write the new input first; the heads always read at least a few samples behind it
+        for (int i = 0; i < numThisTime; ++i)
+            mixRing[(size_t) ((writePosition + i) & ringMask)] = 0.0f;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* input = channelData[ch] + done;
+            auto& ring = rings[(size_t) ch];
+
+            for (int i = 0; i < numThisTime; ++i)
+            {
+                const auto pos = (size_t) ((writePosition + i) & ringMask);
+                ring[pos] = input[i];
+                mixRing[pos] += input[i];
+            }
+        }
+
+        const auto start = writePosition + ringSize - delay;
+        const auto nextStart = writePosition + ringSize - nextDelay;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* ring = rings[(size_t) ch].data();
+            auto* output = channelData[ch] + done;
+
+            if (fading)
+            {
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    const auto outgoing = readHermite (ring, start + i * ratio);
+                    const auto incoming = readHermite (ring, nextStart + i * ratio);
+                    const auto gain = (float) (fadePosition + i + 1) / (float) fadeLength;
+                    output[i] = outgoing + gain * (incoming - outgoing);
+                }
+            }
+            else
+            {
+                for (int i = 0; i < numThisTime; ++i)
+                    output[i] = readHermite (ring, start + i * ratio);
+            }
+        }
+
+        writePosition = (writePosition + numThisTime) & ringMask;
+        delay += numThisTime * drift;
+        done += numThisTime;
+
+        if (ramping)
+            pitchRatio.skip (numThisTime);
+
+        if (fading)
+        {
+            nextDelay += numThisTime * drift;
+            fadePosition += numThisTime;
+
+            if (fadePosition >= fadeLength)
+            {
+                delay = nextDelay;
+                fading = false;
+            }
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeArena.h"
+
+//==============================================================================
+/**
+    Low-latency time-domain pitch shifter (WSOLA).
+
+    Every channel is written into a short delay line and read back by a head
+    moving at the pitch ratio. When the head drifts out of its window around the
+    nominal delay, it jumps by the lag (between a quarter and one look-ahead)
+    that best matches the waveform it is leaving, found by normalised
+    cross-correlation on the channel sum, and crossfades to the new position.
+    For voiced material that lag lands on a whole number of pitch periods, which
+    makes the jump pitch-synchronous without a separate pitch detector.
+
+    The look-ahead is fixed at 5 ms whatever the host block size, and it's what
+    getLatencyInSamples() reports. The delay lines come from the RealtimeArena, so
+    nothing allocates after prepare().
+*/
+class WsolaShifter
+{
+public:
+    //==============================================================================
+    WsolaShifter() = default;
+
+    /** Takes the delay lines from the arena. Not realtime-safe. */
+    void prepare (const juce::dsp::ProcessSpec& spec, RealtimeArena& arena);
+
+    /** Clears the delay lines and parks the read head at the nominal delay. */
+    void reset() noexcept;
+
+    /** Sets the frequency ratio (2^(semitones / 12)) to ramp to; supports 0.25 to 4.
+        The read head speed follows the ramp in short steps over pitchRampSeconds.
+    */
+    void setPitchRatio (float newRatio) noexcept        { pitchRatio.setTargetValue (newRatio); }
+
+    /** True while the pitch ratio is still ramping towards its target. */
+    bool isSmoothing() const noexcept                   { return pitchRatio.isSmoothing(); }
+
+    /** Shifts the given channels in place. numChannels must not exceed the prepared count. */
+    void process (float* const* channelData, int numChannels, int numSamples) noexcept;
+
+    /** The nominal delay the read head is kept centred on. */
+    int getLatencyInSamples() const noexcept            { return lookahead; }
+
+    static constexpr double lookaheadSeconds = 0.005;
+    static constexpr double pitchRampSeconds = 0.05;
+
+private:
+    //==============================================================================
+    int getSamplesUntilJump (double drift) const noexcept;
+    void startJump (double drift) noexcept;
+    float readHermite (const float* ring, double position) const noexcept;
+
+    //==============================================================================
+    RealtimeArena::Array<RealtimeArena::Array<float>> rings;
+    RealtimeArena::Array<float> mixRing;    // sum of all channels, used for the lag search
+    int ringSize = 0, ringMask = 0, writePosition = 0;
+
+    int lookahead = 0, minJump = 0, maxJump = 0, correlationLength = 0, defaultFadeLength = 0;
+    double minDelay = 0.0, maxDelay = 0.0;
+
+    double delay = 0.0, nextDelay = 0.0;
+    int fadeLength = 0, fadePosition = 0;
+    bool fading = false;
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> pitchRatio { 1.0f };
+
+    static constexpr int maxChunk = 256, maxRampChunk = 32;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WsolaShifter)
+};
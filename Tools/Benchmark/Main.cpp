@@ -0,0 +1,615 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "RealtimeSafety.h"
+#include "SpectralKernels.h"
+#include "TestSignal.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+//==============================================================================
+/*
+    Drives PitchMorpherAudioProcessor::prepareToPlay/processBlock directly and
+    reports per-case timings as JSON.
+
+    Every case gets a fresh processor and the same deterministic test signal.
+    Blocks are timed one at a time, after half a second of warm-up, and
+    allocations are counted by the realtime-safety checks around processBlock.
+    prepareToPlay is timed as well, and each case reports the memory its
+    instance holds next to the process-wide shared tables.
+
+    --verify-kernels instead compares every SIMD kernel set the CPU can run with
+    the scalar kernels on random bins, so each machine can check the kernels it
+    will actually dispatch to.
+*/
+namespace
+{
+    struct BenchmarkCase
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        float pitch = 7.0f, formant = 0.0f;
+        bool lowLatency = false;
+        bool linked = false;
+        bool multicore = false;
+        int quality = (int) PitchShiftEngine::Quality::standard;
+        bool silent = false;
+        int voices = 1;
+        bool internalRate = false;
+
+        juce::String getKey() const
+        {
+            // Unlinked, single-threaded, single-voice, standard-quality keys with the
+            // test signal at the host rate are left as they were, so older baselines still match
+            return "rate=" + juce::String ((int) sampleRate) + " block=" + juce::String (blockSize)
+                 + " channels=" + juce::String (numChannels) + " pitch=" + juce::String (pitch)
+                 + " formant=" + juce::String (formant) + " mode=" + (lowLatency ? "lowLatency" : "highQuality")
+                 + (linked ? " linked=1" : "") + (multicore ? " multicore=1" : "")
+                 + (quality != (int) PitchShiftEngine::Quality::standard ? " quality=" + juce::String (quality) : juce::String())
+                 + (silent ? " signal=silence" : "") + (voices != 1 ? " voices=" + juce::String (voices) : juce::String())
+                 + (internalRate ? " internalRate=1" : "");
+        }
+    };
+
+    struct BenchmarkResult
+    {
+        BenchmarkCase config;
+        int numBlocks = 0;
+        double nsPerSample = 0.0, meanBlockMicroseconds = 0.0, p99BlockMicroseconds = 0.0, worstBlockMicroseconds = 0.0;
+        double allocationsPerBlock = 0.0;
+        double prepareMilliseconds = 0.0;
+        size_t instanceBytes = 0, sharedTableBytes = 0;
+
+        /** Share of one core needed to keep up in realtime. */
+        double getRealtimeLoadPercent() const
+        {
+            return nsPerSample * config.sampleRate * 1.0e-7;
+        }
+    };
+
+    //==============================================================================
+    void setParameter (PitchMorpherAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        if (auto* parameter = processor.parameters.getParameter (parameterID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    bool runCase (const BenchmarkCase& config, double seconds, BenchmarkResult& result)
+    {
+        PitchMorpherAudioProcessor processor;
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (juce::AudioChannelSet::canonicalChannelSet (config.numChannels));
+        layout.outputBuses.add (juce::AudioChannelSet::canonicalChannelSet (config.numChannels));
+
+        if (! processor.setBusesLayout (layout))
+            return false;
+
+        setParameter (processor, PitchMorpherAudioProcessor::PITCH_ID, config.pitch);
+        setParameter (processor, PitchMorpherAudioProcessor::FORMANT_ID, config.formant);
+        setParameter (processor, PitchMorpherAudioProcessor::MIX_ID, 100.0f);
+        setParameter (processor, PitchMorpherAudioProcessor::LATENCY_MODE_ID, config.lowLatency ? 1.0f : 0.0f);
+        setParameter (processor, PitchMorpherAudioProcessor::LINK_CHANNELS_ID, config.linked ? 1.0f : 0.0f);
+        setParameter (processor, PitchMorpherAudioProcessor::MULTICORE_ID, config.multicore ? 1.0f : 0.0f);
+        setParameter (processor, PitchMorpherAudioProcessor::QUALITY_ID, (float) config.quality);
+        setParameter (processor, PitchMorpherAudioProcessor::VOICES_ID, (float) (config.voices - 1));
+        setParameter (processor, PitchMorpherAudioProcessor::INTERNAL_RATE_ID, config.internalRate ? 1.0f : 0.0f);
+
+        processor.setRateAndBufferSizeDetails (config.sampleRate, config.blockSize);
+
+        const auto prepareStart = juce::Time::getHighResolutionTicks();
+        processor.prepareToPlay (config.sampleRate, config.blockSize);
+        result.prepareMilliseconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - prepareStart) * 1000.0;
+
+        const auto memory = processor.getMemoryUsage();
+        result.instanceBytes = memory.instanceBytes;
+        result.sharedTableBytes = memory.shared.numBytes;
+
+        // One second of source material, looped
+        const auto sourceBlocks = juce::jmax (1, (int) std::ceil (config.sampleRate / config.blockSize));
+        juce::AudioBuffer<float> source (config.numChannels, sourceBlocks * config.blockSize);
+        juce::AudioBuffer<float> block (config.numChannels, config.blockSize);
+        juce::MidiBuffer midi;
+
+        // Silence measures what a parked instance costs once it has gone idle
+        if (! config.silent)
+            fillTestSignal (source, config.sampleRate);
+
+        const auto numWarmUpBlocks = (int) std::ceil (0.5 * config.sampleRate / config.blockSize);
+        const auto numBlocks = juce::jmax (64, (int) std::ceil (seconds * config.sampleRate / config.blockSize));
+
+        std::vector<juce::int64> blockTicks;
+        blockTicks.reserve ((size_t) numBlocks);
+
+        const auto allocationsBefore = RealtimeSafety::getNumViolations (RealtimeSafety::Violation::allocation);
+
+        for (int i = 0; i < numWarmUpBlocks + numBlocks; ++i)
+        {
+            const auto sourceBlock = i % sourceBlocks;
+
+            for (int ch = 0; ch < config.numChannels; ++ch)
+                block.copyFrom (ch, 0, source, ch, sourceBlock * config.blockSize, config.blockSize);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock (block, midi);
+            const auto end = juce::Time::getHighResolutionTicks();
+
+            if (i >= numWarmUpBlocks)
+                blockTicks.push_back (end - start);
+        }
+
+        const auto allocations = RealtimeSafety::getNumViolations (RealtimeSafety::Violation::allocation) - allocationsBefore;
+        processor.releaseResources();
+
+        auto toMicroseconds = [] (juce::int64 ticks) { return juce::Time::highResolutionTicksToSeconds (ticks) * 1.0e6; };
+
+        juce::int64 totalTicks = 0;
+        for (auto ticks : blockTicks)
+            totalTicks += ticks;
+
+        std::sort (blockTicks.begin(), blockTicks.end());
+
+        result.config = config;
+        result.numBlocks = numBlocks;
+        result.meanBlockMicroseconds = toMicroseconds (totalTicks) / numBlocks;
+        result.nsPerSample = result.meanBlockMicroseconds * 1000.0 / config.blockSize;
+        result.p99BlockMicroseconds = toMicroseconds (blockTicks[(size_t) ((numBlocks - 1) * 99 / 100)]);
+        result.worstBlockMicroseconds = toMicroseconds (blockTicks.back());
+        result.allocationsPerBlock = (double) allocations / (numWarmUpBlocks + numBlocks);
+
+        return true;
+    }
+
+    //==============================================================================
+    juce::var toJson (const BenchmarkResult& result)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("key", result.config.getKey());
+        object->setProperty ("sampleRate", result.config.sampleRate);
+        object->setProperty ("blockSize", result.config.blockSize);
+        object->setProperty ("channels", result.config.numChannels);
+        object->setProperty ("pitch", result.config.pitch);
+        object->setProperty ("formant", result.config.formant);
+        object->setProperty ("mode", result.config.lowLatency ? "lowLatency" : "highQuality");
+        object->setProperty ("linked", result.config.linked);
+        object->setProperty ("multicore", result.config.multicore);
+        object->setProperty ("quality", result.config.quality);
+        object->setProperty ("signal", result.config.silent ? "silence" : "test");
+        object->setProperty ("voices", result.config.voices);
+        object->setProperty ("internalRate", result.config.internalRate);
+        object->setProperty ("blocks", result.numBlocks);
+        object->setProperty ("nsPerSample", result.nsPerSample);
+        object->setProperty ("meanBlockUs", result.meanBlockMicroseconds);
+        object->setProperty ("p99BlockUs", result.p99BlockMicroseconds);
+        object->setProperty ("worstBlockUs", result.worstBlockMicroseconds);
+        object->setProperty ("allocationsPerBlock", result.allocationsPerBlock);
+        object->setProperty ("prepareMs", result.prepareMilliseconds);
+        object->setProperty ("instanceBytes", (juce::int64) result.instanceBytes);
+        object->setProperty ("sharedTableBytes", (juce::int64) result.sharedTableBytes);
+        object->setProperty ("realtimeLoadPercent", result.getRealtimeLoadPercent());
+        return juce::var (object);
+    }
+
+    juce::var getMachineInfo()
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        object->setProperty ("cores", juce::SystemStats::getNumCpus());
+        object->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+        object->setProperty ("kernels", juce::String (SpectralKernels::getBestKernels().name));
+       #if JUCE_DEBUG
+        object->setProperty ("build", "debug");
+       #else
+        object->setProperty ("build", "release");
+       #endif
+        return juce::var (object);
+    }
+
+    //==============================================================================
+    /** Compares against a stored run; prints every regression and returns how many there were. */
+    int compareWithBaseline (const juce::Array<BenchmarkResult>& results, const juce::File& baselineFile, double tolerancePercent)
+    {
+        const auto baseline = juce::JSON::parse (baselineFile);
+
+        if (! baseline.isObject())
+            juce::ConsoleApplication::fail ("Can't parse baseline " + baselineFile.getFullPathName());
+
+        std::map<juce::String, juce::var> baselineCases;
+
+        if (auto* cases = baseline["results"].getArray())
+            for (auto& c : *cases)
+                baselineCases[c["key"].toString()] = c;
+
+        int numRegressions = 0, numCompared = 0;
+
+        for (auto& result : results)
+        {
+            const auto found = baselineCases.find (result.config.getKey());
+
+            if (found == baselineCases.end())
+                continue;
+
+            ++numCompared;
+            const auto& before = found->second;
+            const auto oldNs = (double) before["nsPerSample"];
+            const auto change = 100.0 * (result.nsPerSample - oldNs) / juce::jmax (1.0e-9, oldNs);
+
+            if (change > tolerancePercent)
+            {
+                std::cerr << "REGRESSION " << result.config.getKey() << ": " << juce::String (oldNs, 2) << " -> "
+                          << juce::String (result.nsPerSample, 2) << " ns/sample (+" << juce::String (change, 1) << "%)" << std::endl;
+                ++numRegressions;
+            }
+
+            if ((double) before["allocationsPerBlock"] == 0.0 && result.allocationsPerBlock > 0.0)
+            {
+                std::cerr << "REGRESSION " << result.config.getKey() << ": processBlock now allocates ("
+                          << juce::String (result.allocationsPerBlock, 3) << " per block)" << std::endl;
+                ++numRegressions;
+            }
+        }
+
+        std::cerr << "Compared " << numCompared << " of " << results.size() << " cases with "
+                  << baselineFile.getFileName() << ": " << numRegressions << " regression(s)" << std::endl;
+
+        return numRegressions;
+    }
+
+    //==============================================================================
+    template <typename Type>
+    juce::Array<Type> getListOption (const juce::ArgumentList& args, const juce::String& option, juce::Array<Type> defaults)
+    {
+        if (! args.containsOption (option))
+            return defaults;
+
+        juce::Array<Type> values;
+
+        for (auto& item : juce::StringArray::fromTokens (args.getValueForOption (option), ",", {}))
+        {
+            if (item.trim().isEmpty())
+                continue;
+
+            if constexpr (std::is_same<Type, int>::value)
+                values.add (item.getIntValue());
+            else
+                values.add ((Type) item.getDoubleValue());
+        }
+
+        if (values.isEmpty())
+            juce::ConsoleApplication::fail (option + " needs a comma-separated list");
+
+        return values;
+    }
+
+    //==============================================================================
+    /** Largest error of one kernel set against the scalar kernels, per output. Phases
+        are in radians, the real and imaginary parts relative to their bin's
+        magnitude, and everything else relative to the scalar result.
+    */
+    struct KernelErrors
+    {
+        double phase = 0.0, magnitude = 0.0, frequency = 0.0, cartesian = 0.0, dotProduct = 0.0;
+
+        double getWorst() const     { return std::max ({ phase, magnitude, frequency, cartesian, dotProduct }); }
+    };
+
+    /** Runs analyse, synthesise and dotProduct on the same random bins through both
+        kernel sets and records how far apart they land.
+    */
+    void compareKernels (const SpectralKernels::KernelTable& kernels, const SpectralKernels::KernelTable& scalar,
+                         int numBins, int overlap, juce::Random& random, KernelErrors& errors)
+    {
+        using Buffer = std::vector<float>;
+        constexpr auto pi = juce::MathConstants<double>::pi;
+        constexpr auto twoPi = juce::MathConstants<double>::twoPi;
+
+        const auto padded = SpectralKernels::getPaddedBinCount (numBins);
+        const auto radiansPerBin = (float) (twoPi / overlap);
+        const auto randomPhase = [&random] { return (float) ((random.nextDouble() * 2.0 - 1.0) * pi); };
+        const auto phaseError = [] (float a, float b) { return std::abs (std::remainder ((double) a - (double) b, twoPi)); };
+        const auto relativeError = [] (float a, float reference) { return std::abs ((double) a - (double) reference) / std::max (1.0, std::abs ((double) reference)); };
+
+        // The padding stays zeroed, as the kernels require
+        Buffer real (padded), imag (padded), expectedPhase (padded), lastPhase (padded);
+        Buffer magnitude (padded), frequency (padded), sumPhase (padded);
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            // Every so often an empty bin, whose phase is whatever atan2 makes of (0, 0)
+            const auto binMagnitude = k % 37 == 0 ? 0.0f : random.nextFloat();
+            const auto binPhase = randomPhase();
+            real[(size_t) k] = binMagnitude * std::cos (binPhase);
+            imag[(size_t) k] = binMagnitude * std::sin (binPhase);
+
+            expectedPhase[(size_t) k] = (float) std::remainder (twoPi * k / overlap, twoPi);
+            lastPhase[(size_t) k] = randomPhase();
+
+            magnitude[(size_t) k] = random.nextFloat();
+            frequency[(size_t) k] = (float) k + (random.nextFloat() * 4.0f - 2.0f);
+            sumPhase[(size_t) k] = randomPhase();
+        }
+
+        {
+            Buffer testLastPhase (lastPhase), testMagnitude (padded), testFrequency (padded);
+            Buffer scalarLastPhase (lastPhase), scalarMagnitude (padded), scalarFrequency (padded);
+
+            kernels.analyse (real.data(), imag.data(), expectedPhase.data(), testLastPhase.data(),
+                             testMagnitude.data(), testFrequency.data(), padded, 1.0f / radiansPerBin);
+            scalar.analyse (real.data(), imag.data(), expectedPhase.data(), scalarLastPhase.data(),
+                            scalarMagnitude.data(), scalarFrequency.data(), padded, 1.0f / radiansPerBin);
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const auto i = (size_t) k;
+                errors.phase = std::max (errors.phase, phaseError (testLastPhase[i], scalarLastPhase[i]));
+                errors.magnitude = std::max (errors.magnitude, relativeError (testMagnitude[i], scalarMagnitude[i]));
+
+                // A phase advance right on +/-pi may wrap either way, which moves the
+                // frequency by a whole overlap's worth of bins; both are correct
+                const auto frequencyDifference = std::remainder ((double) testFrequency[i] - (double) scalarFrequency[i], (double) overlap);
+                errors.frequency = std::max (errors.frequency, std::abs (frequencyDifference) / std::max (1.0, std::abs ((double) scalarFrequency[i])));
+            }
+        }
+
+        {
+            Buffer testSumPhase (sumPhase), testReal (padded), testImag (padded);
+            Buffer scalarSumPhase (sumPhase), scalarReal (padded), scalarImag (padded);
+
+            kernels.synthesise (magnitude.data(), frequency.data(), expectedPhase.data(), testSumPhase.data(),
+                                testReal.data(), testImag.data(), padded, radiansPerBin);
+            scalar.synthesise (magnitude.data(), frequency.data(), expectedPhase.data(), scalarSumPhase.data(),
+                               scalarReal.data(), scalarImag.data(), padded, radiansPerBin);
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const auto i = (size_t) k;
+                const auto scale = std::max (1.0e-6, (double) magnitude[i]);
+                errors.phase = std::max (errors.phase, phaseError (testSumPhase[i], scalarSumPhase[i]));
+                errors.cartesian = std::max (errors.cartesian, std::abs ((double) testReal[i] - (double) scalarReal[i]) / scale);
+                errors.cartesian = std::max (errors.cartesian, std::abs ((double) testImag[i] - (double) scalarImag[i]) / scale);
+            }
+        }
+
+        {
+            // Relative to the sum of the products' sizes, as the order of the sum differs
+            const auto numTaps = padded;
+            Buffer a ((size_t) numTaps), b ((size_t) numTaps);
+            double size = 0.0;
+
+            for (int i = 0; i < numTaps; ++i)
+            {
+                a[(size_t) i] = random.nextFloat() * 2.0f - 1.0f;
+                b[(size_t) i] = random.nextFloat() * 2.0f - 1.0f;
+                size += std::abs ((double) a[(size_t) i] * (double) b[(size_t) i]);
+            }
+
+            const auto difference = (double) kernels.dotProduct (a.data(), b.data(), numTaps) - (double) scalar.dotProduct (a.data(), b.data(), numTaps);
+            errors.dotProduct = std::max (errors.dotProduct, std::abs (difference) / std::max (1.0e-30, size));
+        }
+    }
+
+    /** Checks every SIMD kernel set this CPU can run against the scalar kernels, and
+        fails if any output strays further than the tolerance.
+    */
+    void verifyKernels (const juce::ArgumentList&)
+    {
+        using SpectralKernels::InstructionSet;
+
+        // The variants share their polynomials, so they only differ by rounding and
+        // fused multiply-adds, around 1e-6. A wrong coefficient is off by more.
+        constexpr double tolerance = 1.0e-5;
+        constexpr int numRounds = 8;
+
+        const auto& scalar = *SpectralKernels::getKernels (InstructionSet::scalar);
+        int numFailed = 0, numVerified = 0;
+
+        for (auto set : { InstructionSet::sse2, InstructionSet::avx2, InstructionSet::avx512 })
+        {
+            auto* kernels = SpectralKernels::getKernels (set);
+
+            if (kernels == nullptr)
+                continue;
+
+            // The same bins for every set, from frame sizes 32 to 16384 and a few odd
+            // counts that end partway into a vector
+            juce::Random random (0x5eed);
+            KernelErrors errors;
+
+            for (int round = 0; round < numRounds; ++round)
+                for (auto numBins : { 1, 17, 33, 129, 257, 513, 1025, 2049, 4097, 8193 })
+                    for (auto overlap : { 2, 4, 8 })
+                        compareKernels (*kernels, scalar, numBins, overlap, random, errors);
+
+            const auto passed = errors.getWorst() <= tolerance;
+
+            std::cerr << (passed ? "OK   " : "FAIL ") << kernels->name << " against scalar: phase " << errors.phase
+                      << " rad, magnitude " << errors.magnitude << ", frequency " << errors.frequency
+                      << ", real/imag " << errors.cartesian << ", dot product " << errors.dotProduct << std::endl;
+
+            ++numVerified;
+
+            if (! passed)
+                ++numFailed;
+        }
+
+        if (numVerified == 0)
+            std::cerr << "Only the scalar kernels run on this machine; nothing to compare" << std::endl;
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail (juce::String (numFailed) + " kernel set(s) exceeded the tolerance of " + juce::String (tolerance));
+    }
+
+    void runBenchmarks (const juce::ArgumentList& args)
+    {
+        const auto quick = args.containsOption ("--quick");
+
+        const auto blockSizes  = getListOption<int>    (args, "--blocks",   quick ? juce::Array<int> { 64, 512 } : juce::Array<int> { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 });
+        const auto sampleRates = getListOption<double> (args, "--rates",    quick ? juce::Array<double> { 48000.0 } : juce::Array<double> { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 });
+        const auto channels    = getListOption<int>    (args, "--channels", quick ? juce::Array<int> { 2 } : juce::Array<int> { 1, 2, 8 });
+        const auto pitches     = getListOption<float>  (args, "--pitch",    quick ? juce::Array<float> { 7.0f } : juce::Array<float> { -12.0f, 7.0f });
+        const auto formants    = getListOption<float>  (args, "--formant",  quick ? juce::Array<float> { 0.0f } : juce::Array<float> { 0.0f, 4.0f });
+        const auto links       = getListOption<int>    (args, "--linked",   quick ? juce::Array<int> { 0 } : juce::Array<int> { 0, 1 });
+        const auto multicores  = getListOption<int>    (args, "--multicore", quick ? juce::Array<int> { 0 } : juce::Array<int> { 0, 1 });
+        const auto qualities   = getListOption<int>    (args, "--quality",  juce::Array<int> { (int) PitchShiftEngine::Quality::standard });
+        const auto modes       = args.containsOption ("--mode") ? juce::StringArray::fromTokens (args.getValueForOption ("--mode"), ",", {})
+                                                                : juce::StringArray { "highQuality", "lowLatency" };
+        const auto voiceCounts = getListOption<int>    (args, "--voices",   juce::Array<int> { 1 });
+        const auto internalRates = getListOption<int>  (args, "--internal-rate", juce::Array<int> { 0 });
+        const auto signals     = args.containsOption ("--signal") ? juce::StringArray::fromTokens (args.getValueForOption ("--signal"), ",", {})
+                                                                  : juce::StringArray { "test" };
+        const auto seconds     = args.containsOption ("--seconds") ? juce::jmax (0.1, args.getValueForOption ("--seconds").getDoubleValue()) : 2.0;
+
+        juce::Array<BenchmarkCase> cases;
+
+        for (auto rate : sampleRates)
+            for (auto blockSize : blockSizes)
+                for (auto numChannels : channels)
+                    for (auto& mode : modes)
+                        for (auto pitch : pitches)
+                            for (auto formant : formants)
+                                for (auto link : links)
+                                    for (auto multi : multicores)
+                                        for (auto quality : qualities)
+                                            for (auto& signal : signals)
+                                                for (auto voices : voiceCounts)
+                                                    for (auto internal : internalRates)
+                                                    {
+                                                        // The low-latency engine ignores the formant, so one value is enough there
+                                                        const auto lowLatency = mode == "lowLatency";
+
+                                                        if (lowLatency && formant != formants.getFirst())
+                                                            continue;
+
+                                                        // Linking only changes the phase vocoder, and only with more than one channel
+                                                        const auto linked = link != 0;
+
+                                                        if (linked && (lowLatency || numChannels < 2))
+                                                            continue;
+
+                                                        // Likewise for spreading channels over worker threads
+                                                        const auto multicore = multi != 0;
+
+                                                        if (multicore && (lowLatency || numChannels < 2))
+                                                            continue;
+
+                                                        // The tiers only exist in the phase vocoder
+                                                        if (lowLatency && quality != qualities.getFirst())
+                                                            continue;
+
+                                                        const auto tier = lowLatency ? (int) PitchShiftEngine::Quality::standard
+                                                                                     : juce::jlimit (0, PitchShiftEngine::numQualities - 1, quality);
+
+                                                        // Harmony voices only exist in the phase vocoder
+                                                        if (lowLatency && voices != voiceCounts.getFirst())
+                                                            continue;
+
+                                                        const auto numVoices = lowLatency ? 1 : juce::jlimit (1, PitchMorpherAudioProcessor::maxVoices, voices);
+
+                                                        // The internal rate only changes anything at rates that divide down to it
+                                                        const auto internalRate = internal != 0;
+
+                                                        if (internalRate && PolyphaseResampler::chooseFactor (rate) == 1)
+                                                            continue;
+
+                                                        cases.add ({ rate, blockSize, numChannels, pitch, formant, lowLatency, linked, multicore, tier, signal == "silence", numVoices, internalRate });
+                                                    }
+
+        juce::Array<BenchmarkResult> results;
+        juce::Array<juce::var> resultsJson;
+
+        for (int i = 0; i < cases.size(); ++i)
+        {
+            BenchmarkResult result;
+
+            if (! runCase (cases.getReference (i), seconds, result))
+            {
+                std::cerr << "Skipping unsupported layout: " << cases.getReference (i).getKey() << std::endl;
+                continue;
+            }
+
+            std::cerr << "[" << (i + 1) << "/" << cases.size() << "] " << result.config.getKey() << ": "
+                      << juce::String (result.nsPerSample, 2) << " ns/sample, p99 " << juce::String (result.p99BlockMicroseconds, 1)
+                      << " us, worst " << juce::String (result.worstBlockMicroseconds, 1) << " us" << std::endl;
+
+            results.add (result);
+            resultsJson.add (toJson (result));
+        }
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty ("benchmark", "PitchMorpherAudioProcessor::processBlock");
+        report->setProperty ("version", ProjectInfo::versionString);
+        report->setProperty ("machine", getMachineInfo());
+        report->setProperty ("secondsPerCase", seconds);
+        report->setProperty ("results", resultsJson);
+
+        const auto json = juce::JSON::toString (juce::var (report));
+
+        if (args.containsOption ("--output"))
+        {
+            const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--output"));
+
+            if (! file.replaceWithText (json))
+                juce::ConsoleApplication::fail ("Can't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+
+        if (args.containsOption ("--baseline"))
+        {
+            const auto baselineFile = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--baseline"));
+            const auto tolerance = args.containsOption ("--tolerance") ? args.getValueForOption ("--tolerance").getDoubleValue() : 10.0;
+
+            if (compareWithBaseline (results, baselineFile, tolerance) > 0)
+                juce::ConsoleApplication::fail ("Performance regressed against " + baselineFile.getFileName());
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameter state posts updates to the message thread
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Usage: PitchMorpherBenchmark [options]", false);
+
+    app.addCommand ({ "--verify-kernels",
+                      "--verify-kernels",
+                      "Checks every SIMD kernel set this CPU supports against the scalar kernels",
+                      "Runs analyse, synthesise and dotProduct on random bins through the SSE2,\n"
+                      "AVX2 and AVX-512 kernels this machine can run, compares each output with\n"
+                      "the scalar kernels and fails if any differs by more than 1e-5",
+                      verifyKernels });
+
+    app.addDefaultCommand ({ "",
+                             "[options]",
+                             "Times processBlock over a sweep of settings and prints the results as JSON",
+                             "Options (lists are comma-separated):\n"
+                             "  --blocks=<sizes>       block sizes (default 16 to 4096)\n"
+                             "  --rates=<hz>           sample rates (default 44100 to 192000)\n"
+                             "  --channels=<counts>    channel counts (default 1,2,8)\n"
+                             "  --linked=<0|1>         unlinked and/or linked channels (default 0,1)\n"
+                             "  --multicore=<0|1>      single-threaded and/or multicore (default 0,1)\n"
+                             "  --quality=<tiers>      quality tiers, 0 (draft) to 5 (multi-resolution)\n"
+                             "                         (default 2, standard)\n"
+                             "  --pitch=<semitones>    pitch shifts (default -12,7)\n"
+                             "  --formant=<semitones>  formant shifts (default 0,4)\n"
+                             "  --mode=<modes>         highQuality and/or lowLatency (default both)\n"
+                             "  --voices=<counts>      harmony voices, 1 to 4 (default 1)\n"
+                             "  --internal-rate=<0|1>  host rate and/or fixed internal rate (default 0)\n"
+                             "  --signal=<signals>     test (saws and noise) and/or silence (default test)\n"
+                             "  --seconds=<seconds>    audio timed per case (default 2)\n"
+                             "  --quick                a small sweep for a fast check\n"
+                             "  --output=<file>        write the JSON to a file instead of stdout\n"
+                             "  --baseline=<file>      compare with an earlier run's JSON and fail if any\n"
+                             "                         case got slower or started allocating\n"
+                             "  --tolerance=<percent>  allowed slow-down per case (default 10)",
+                             runBenchmarks });
+
+    return app.findAndRunCommand (argc, argv);
+}
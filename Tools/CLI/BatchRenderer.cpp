@@ -0,0 +1,271 @@
+#include "BatchRenderer.h"
+
+//==============================================================================
+void BatchRenderer::FileJob::fail (const juce::Result& failure)
+{
+    const std::lock_guard<std::mutex> rl (resultLock);
+
+    if (result.wasOk())
+        result = failure;
+}
+
+//==============================================================================
+BatchRenderer::BatchRenderer (const RenderSettings& settingsToUse, const Options& optionsToUse)
+    : settings (settingsToUse), options (optionsToUse)
+{
+}
+
+void BatchRenderer::addFile (const juce::File& input, const juce::File& output)
+{
+    auto file = std::make_unique<FileJob>();
+    file->input = input;
+    file->output = output;
+    files.push_back (std::move (file));
+}
+
+//==============================================================================
+juce::Result BatchRenderer::planSegments (FileJob& file, OfflineRenderer& renderer)
+{
+    auto reader = renderer.createReader (file.input);
+
+    if (reader == nullptr)
+        return juce::Result::fail ("Can't read " + file.input.getFullPathName());
+
+    file.length = reader->lengthInSamples;
+    file.sampleRate = reader->sampleRate;
+    file.crossfadeLength = juce::jmax ((juce::int64) 1, (juce::int64) (crossfadeSeconds * file.sampleRate));
+
+    // Without a segment length the whole file is one segment, rendered in one pass
+    file.segmentLength = options.segmentSeconds > 0.0 ? juce::jmax ((juce::int64) 1, (juce::int64) (options.segmentSeconds * file.sampleRate))
+                                                      : juce::jmax ((juce::int64) 1, file.length);
+
+    // Every segment but the last covers its own stretch plus the crossfade into the
+    // next; the last takes whatever remains, which is always longer than that
+    const auto numSegments = (size_t) juce::jmax ((juce::int64) 1, (file.length - file.crossfadeLength) / file.segmentLength);
+
+    file.segments.resize (numSegments);
+
+    for (size_t i = 0; i < numSegments; ++i)
+    {
+        auto& segment = file.segments[i];
+        segment.start = (juce::int64) i * file.segmentLength;
+        segment.length = i + 1 < numSegments ? file.segmentLength + file.crossfadeLength
+                                             : file.length - segment.start;
+    }
+
+    file.segmentsRemaining = (int) numSegments;
+    return juce::Result::ok();
+}
+
+void BatchRenderer::renderSegment (FileJob& file, size_t segmentIndex, OfflineRenderer& renderer)
+{
+    auto& segment = file.segments[segmentIndex];
+    const auto isWholeFile = file.segments.size() == 1;
+
+    auto result = [&]
+    {
+        auto reader = renderer.createReader (file.input);
+
+        if (reader == nullptr)
+            return juce::Result::fail ("Can't read " + file.input.getFullPathName());
+
+        // A file in one piece goes straight to its output; segments go to float
+        // temporaries so the stitching quantises only once
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        juce::Result opened = juce::Result::ok();
+
+        if (isWholeFile)
+        {
+            opened = renderer.createWriter (file.output, *reader, 0, writer);
+        }
+        else
+        {
+            segment.part = std::make_unique<juce::TemporaryFile> (file.output.withFileExtension ("wav"));
+            opened = renderer.createWriter (segment.part->getFile(), *reader, 32, writer);
+        }
+
+        if (opened.failed())
+            return opened;
+
+        const auto preRoll = (juce::int64) (preRollSeconds * file.sampleRate);
+        return renderer.renderRange (*reader, *writer, segment.start, segment.length, preRoll);
+    }();
+
+    if (result.failed())
+        file.fail (result);
+
+    // Whoever finishes the last segment of a file stitches it
+    if (--file.segmentsRemaining > 0)
+        return;
+
+    if (! isWholeFile)
+    {
+        if (file.result.wasOk())
+        {
+            result = stitch (file, renderer);
+
+            if (result.failed())
+                file.fail (result);
+        }
+
+        for (auto& s : file.segments)
+            s.part.reset();
+    }
+
+    if (file.result.failed())
+        file.output.deleteFile();
+}
+
+juce::Result BatchRenderer::stitch (FileJob& file, OfflineRenderer& renderer)
+{
+    auto source = renderer.createReader (file.input);
+
+    if (source == nullptr)
+        return juce::Result::fail ("Can't read " + file.input.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    const auto opened = renderer.createWriter (file.output, *source, 0, writer);
+
+    if (opened.failed())
+        return opened;
+
+    std::vector<std::unique_ptr<juce::AudioFormatReader>> parts;
+
+    for (auto& segment : file.segments)
+    {
+        parts.push_back (renderer.createReader (segment.part->getFile()));
+
+        if (parts.back() == nullptr)
+            return juce::Result::fail ("Can't read back a rendered segment of " + file.input.getFileName());
+    }
+
+    const auto numChannels = (int) source->numChannels;
+    const auto blockSize = juce::jmax (16, settings.blockSize);
+    juce::AudioBuffer<float> current (numChannels, blockSize), previous (numChannels, blockSize);
+
+    auto write = [&] (int numSamples)
+    {
+        return writer->writeFromAudioSampleBuffer (current, 0, numSamples);
+    };
+
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        auto& part = *parts[i];
+        juce::int64 position = 0;
+
+        if (i > 0)
+        {
+            // Equal-power crossfade from the end of the previous segment, which
+            // rendered this overlap as its tail. Each segment's vocoder started from
+            // its own phases, so the two sides are uncorrelated and equal gains
+            // would dip in the middle.
+            for (juce::int64 done = 0; done < file.crossfadeLength;)
+            {
+                const auto numThisTime = (int) juce::jmin ((juce::int64) blockSize, file.crossfadeLength - done);
+
+                parts[i - 1]->read (&previous, 0, numThisTime, file.segmentLength + done, true, true);
+                part.read (&current, 0, numThisTime, done, true, true);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                {
+                    auto* out = current.getWritePointer (ch);
+                    const auto* tail = previous.getReadPointer (ch);
+
+                    for (int n = 0; n < numThisTime; ++n)
+                    {
+                        const auto angle = juce::MathConstants<double>::halfPi * ((double) (done + n) + 0.5) / (double) file.crossfadeLength;
+                        out[n] = (float) (out[n] * std::sin (angle) + tail[n] * std::cos (angle));
+                    }
+                }
+
+                if (! write (numThisTime))
+                    return juce::Result::fail ("Error writing " + file.output.getFullPathName());
+
+                done += numThisTime;
+            }
+
+            position = file.crossfadeLength;
+        }
+
+        const auto end = i + 1 < parts.size() ? file.segmentLength : file.segments[i].length;
+
+        while (position < end)
+        {
+            const auto numThisTime = (int) juce::jmin ((juce::int64) blockSize, end - position);
+            part.read (&current, 0, numThisTime, position, true, true);
+
+            if (! write (numThisTime))
+                return juce::Result::fail ("Error writing " + file.output.getFullPathName());
+
+            position += numThisTime;
+        }
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Array<juce::Result> BatchRenderer::run()
+{
+    report = {};
+    report.numThreads = options.numThreads > 0 ? options.numThreads : juce::SystemStats::getNumCpus();
+
+    // One renderer (and so one processor) per worker, created up front
+    std::vector<std::unique_ptr<OfflineRenderer>> renderers;
+
+    for (int i = 0; i < report.numThreads; ++i)
+        renderers.push_back (std::make_unique<OfflineRenderer> (settings));
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    // Plan everything before any worker starts using the renderers
+    for (auto& file : files)
+    {
+        const auto planned = planSegments (*file, *renderers.front());
+
+        if (planned.failed())
+            file->fail (planned);
+        else
+            report.numSegments += (int) file->segments.size();
+    }
+
+    {
+        WorkStealingPool pool (report.numThreads);
+
+        for (auto& file : files)
+        {
+            if (file->result.failed())
+                continue;
+
+            for (size_t i = 0; i < file->segments.size(); ++i)
+            {
+                pool.addJob ([this, &job = *file, i, &renderers] (int workerIndex)
+                {
+                    renderSegment (job, i, *renderers[(size_t) workerIndex]);
+                });
+            }
+        }
+
+        pool.waitUntilIdle();
+    }
+
+    report.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+    profile = {};
+
+    for (auto& renderer : renderers)
+        profile += renderer->getProfiler().getSnapshot();
+
+    juce::Array<juce::Result> results;
+
+    for (auto& file : files)
+    {
+        results.add (file->result);
+
+        if (file->result.wasOk())
+            report.audioSeconds += (double) file->length / file->sampleRate;
+    }
+
+    files.clear();
+    return results;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "WorkStealingPool.h"
+
+//==============================================================================
+/**
+    Renders many files across all cores.
+
+    By default each file is one job, rendered in one pass straight to its output,
+    so the result is identical to OfflineRenderer::render() and the files spread
+    over the workers. Jobs run on a WorkStealingPool, and each worker owns one
+    OfflineRenderer (and so one processor), freshly prepared for every job, so
+    the output is bit-identical whatever the thread count.
+
+    With a segment length set, longer files are also cut into segments, each an
+    independent job with its own pre-roll, so a single long file spreads over
+    every worker. Segments are rendered to 32-bit float temporary files and
+    stitched with an equal-power crossfade over the overlap at each boundary:
+    each segment's vocoder starts from fresh synthesis phases, so the two sides
+    are uncorrelated there. Segmented output is still the same for any thread
+    count, but differs slightly from a one-pass render around each boundary.
+*/
+class BatchRenderer
+{
+public:
+    //==============================================================================
+    struct Options
+    {
+        int numThreads = 0;             // 0 uses every core
+        double segmentSeconds = 0.0;    // 0 renders every file in one pass, else files longer than this are split
+    };
+
+    BatchRenderer (const RenderSettings& settingsToUse, const Options& optionsToUse);
+
+    /** Queues a file; nothing is rendered until run(). */
+    void addFile (const juce::File& input, const juce::File& output);
+
+    /** Renders every queued file. Returns one result per file, in the order added. */
+    juce::Array<juce::Result> run();
+
+    /** Throughput of the last run(). */
+    struct Report
+    {
+        double audioSeconds = 0.0, wallSeconds = 0.0;
+        int numThreads = 0, numSegments = 0;
+
+        double getRealtimeFactor() const noexcept           { return audioSeconds / juce::jmax (1.0e-9, wallSeconds); }
+        double getRealtimeFactorPerCore() const noexcept    { return getRealtimeFactor() / juce::jmax (1, numThreads); }
+    };
+
+    const Report& getReport() const noexcept                { return report; }
+
+    /** Stage timings of the last run(), summed over every worker's processor. */
+    const StageProfiler::Snapshot& getProfile() const noexcept  { return profile; }
+
+    static constexpr double preRollSeconds = 0.5;
+    static constexpr double crossfadeSeconds = 0.05;
+
+private:
+    //==============================================================================
+    struct Segment
+    {
+        juce::int64 start = 0, length = 0;  // output range, including the crossfade overlap
+        std::unique_ptr<juce::TemporaryFile> part;
+    };
+
+    struct FileJob
+    {
+        juce::File input, output;
+        juce::int64 length = 0, segmentLength = 0, crossfadeLength = 0;
+        double sampleRate = 44100.0;
+        std::vector<Segment> segments;
+
+        std::atomic<int> segmentsRemaining { 0 };
+        std::mutex resultLock;
+        juce::Result result = juce::Result::ok();
+
+        void fail (const juce::Result&);
+    };
+
+    juce::Result planSegments (FileJob&, OfflineRenderer&);
+    void renderSegment (FileJob&, size_t segmentIndex, OfflineRenderer&);
+    juce::Result stitch (FileJob&, OfflineRenderer&);
+
+    RenderSettings settings;
+    Options options;
+    std::vector<std::unique_ptr<FileJob>> files;
+    Report report;
+    StageProfiler::Snapshot profile;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchRenderer)
+};
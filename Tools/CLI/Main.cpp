@@ -0,0 +1,206 @@
+#include <JuceHeader.h>
+#include "BatchRenderer.h"
+#include <iostream>
+
+//==============================================================================
+namespace
+{
+    float getFloatOption (const juce::ArgumentList& args, const juce::String& option,
+                          float defaultValue, float minValue, float maxValue)
+    {
+        if (! args.containsOption (option))
+            return defaultValue;
+
+        const auto text = args.getValueForOption (option);
+
+        if (! text.containsOnly ("0123456789.-+"))
+            juce::ConsoleApplication::fail (option + " needs a number, e.g. " + option + "=" + juce::String (defaultValue));
+
+        const auto value = text.getFloatValue();
+
+        if (value < minValue || value > maxValue)
+            juce::ConsoleApplication::fail (option + " must be between " + juce::String (minValue) + " and " + juce::String (maxValue));
+
+        return value;
+    }
+
+    int getIntOption (const juce::ArgumentList& args, const juce::String& option,
+                      int defaultValue, int minValue, int maxValue)
+    {
+        return juce::roundToInt (getFloatOption (args, option, (float) defaultValue, (float) minValue, (float) maxValue));
+    }
+
+    void renderFiles (const juce::ArgumentList& args)
+    {
+        RenderSettings settings;
+        settings.pitchSemitones   = getFloatOption (args, "--pitch",   0.0f,   -24.0f, 24.0f);
+        settings.formantSemitones = getFloatOption (args, "--formant", 0.0f,   -12.0f, 12.0f);
+        settings.mixPercent       = getFloatOption (args, "--mix",     100.0f, 0.0f,   100.0f);
+        settings.quality          = getIntOption   (args, "--quality", settings.quality, 0, PitchShiftEngine::numQualities - 1);
+        settings.blockSize        = getIntOption   (args, "--block",   4096,   16,     65536);
+        settings.bitDepth         = getIntOption   (args, "--bits",    0,      0,      32);
+
+        if (args.containsOption ("--harmony"))
+        {
+            for (auto& item : juce::StringArray::fromTokens (args.getValueForOption ("--harmony"), ",", {}))
+            {
+                const auto semitones = item.trim().getFloatValue();
+
+                if (item.trim().isEmpty() || semitones < -24.0f || semitones > 24.0f)
+                    juce::ConsoleApplication::fail ("--harmony needs a comma-separated list of shifts between -24 and 24");
+
+                settings.harmonySemitones.add (semitones);
+            }
+
+            if (settings.harmonySemitones.size() >= PitchMorpherAudioProcessor::maxVoices)
+                juce::ConsoleApplication::fail ("--harmony takes at most " + juce::String (PitchMorpherAudioProcessor::maxVoices - 1) + " voices");
+        }
+
+        if (args.containsOption ("--correct"))
+        {
+            // Key and scale, e.g. "A,minor"
+            static const juce::StringArray keys { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+            static const juce::StringArray scales { "chromatic", "major", "minor", "harmonic-minor", "major-pentatonic", "minor-pentatonic" };
+            static_assert (PitchTracker::numScales == 6, "One name per scale");
+
+            const auto tokens = juce::StringArray::fromTokens (args.getValueForOption ("--correct"), ",", {});
+            settings.correctionKey = keys.indexOf (tokens[0].trim(), true);
+            settings.correctionScale = tokens.size() > 1 ? scales.indexOf (tokens[1].trim(), true) : 0;
+
+            if (settings.correctionKey < 0 || settings.correctionScale < 0 || tokens.size() > 2)
+                juce::ConsoleApplication::fail ("--correct needs a key and optionally a scale, e.g. --correct=A,minor; scales are "
+                                                + scales.joinIntoString (", "));
+        }
+
+        settings.retuneMs = getFloatOption (args, "--retune", settings.retuneMs, 0.0f, 400.0f);
+        settings.internalRate = args.containsOption ("--internal-rate");
+
+       #if ! PITCHMORPHER_PROFILING
+        if (args.containsOption ("--profile"))
+            juce::ConsoleApplication::fail ("--profile needs a build configured with -DPITCHMORPHER_PROFILING=ON");
+       #endif
+
+        BatchRenderer::Options options;
+        options.numThreads     = getIntOption   (args, "--threads", 0, 0, 1024);
+        options.segmentSeconds = getFloatOption (args, "--segment", 0.0f, 1.0f, 86400.0f);
+
+        juce::Array<juce::File> files;
+
+        for (auto& argument : args.arguments)
+            if (! argument.isOption())
+                files.add (argument.resolveAsFile());
+
+        // Either "input output", or any number of inputs rendered into --output-dir
+        juce::Array<juce::File> inputs, outputs;
+
+        if (args.containsOption ("--output-dir"))
+        {
+            const auto directory = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--output-dir"));
+
+            if (! directory.createDirectory())
+                juce::ConsoleApplication::fail ("Can't create " + directory.getFullPathName());
+
+            for (auto& input : files)
+            {
+                inputs.add (input);
+                outputs.add (directory.getChildFile (input.getFileName()));
+            }
+        }
+        else if (files.size() == 2)
+        {
+            inputs.add (files[0]);
+            outputs.add (files[1]);
+        }
+
+        if (inputs.isEmpty())
+            juce::ConsoleApplication::fail ("Expected an input and an output file, or inputs and --output-dir");
+
+        BatchRenderer renderer (settings, options);
+
+        for (int i = 0; i < inputs.size(); ++i)
+        {
+            if (! inputs[i].existsAsFile())
+                juce::ConsoleApplication::fail ("No such file: " + inputs[i].getFullPathName());
+
+            if (inputs[i] == outputs[i])
+                juce::ConsoleApplication::fail ("The output can't overwrite the input: " + inputs[i].getFullPathName());
+
+            renderer.addFile (inputs[i], outputs[i]);
+        }
+
+        const auto results = renderer.run();
+        int numFailed = 0;
+
+        for (int i = 0; i < results.size(); ++i)
+        {
+            if (results.getReference (i).failed())
+            {
+                std::cerr << inputs[i].getFileName() << ": " << results.getReference (i).getErrorMessage() << std::endl;
+                ++numFailed;
+            }
+        }
+
+        const auto& report = renderer.getReport();
+
+        std::cout << "Rendered " << (results.size() - numFailed) << " of " << results.size() << " files ("
+                  << report.numSegments << " segments, " << juce::String (report.audioSeconds, 1) << " s of audio) in "
+                  << juce::String (report.wallSeconds, 2) << " s on " << report.numThreads << " threads: "
+                  << juce::String (report.getRealtimeFactor(), 1) << "x realtime, "
+                  << juce::String (report.getRealtimeFactorPerCore(), 1) << "x realtime per core"
+                  << std::endl;
+
+        if (args.containsOption ("--profile"))
+        {
+            const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--profile"));
+
+            if (! file.replaceWithText (juce::JSON::toString (renderer.getProfile().toJson())))
+                juce::ConsoleApplication::fail ("Can't write " + file.getFullPathName());
+        }
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail (juce::String (numFailed) + " file(s) failed");
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameter state posts updates to the message thread
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Usage: PitchMorpherCLI [options] input output\n"
+                                     "       PitchMorpherCLI [options] --output-dir=<dir> inputs...", false);
+
+    app.addDefaultCommand ({ "",
+                             "[options] input output | [options] --output-dir=<dir> inputs...",
+                             "Pitch-shifts audio files (WAV, AIFF or FLAC) with the high-quality engine",
+                             "Options:\n"
+                             "  --pitch=<semitones>    pitch shift, -24 to 24 (default 0)\n"
+                             "  --formant=<semitones>  formant shift, -12 to 12 (default 0, formants preserved)\n"
+                             "  --mix=<percent>        wet/dry mix, 0 to 100 (default 100)\n"
+                             "  --harmony=<semitones>  up to 3 more voices, e.g. 4,7 (default none)\n"
+                             "  --correct=<key,scale>  snap the pitch to a scale, e.g. A,minor (scales: chromatic,\n"
+                             "                         major, minor, harmonic-minor, major-pentatonic,\n"
+                             "                         minor-pentatonic; default off)\n"
+                             "  --retune=<ms>          glide time to the corrected note, 0 to 400 (default 50)\n"
+                             "  --quality=<tier>       0 draft (512), 1 low (1024), 2 standard (2048),\n"
+                             "                         3 high (4096), 4 ultra (8192), 5 multi-resolution\n"
+                             "                         (default 4)\n"
+                             "  --internal-rate        run the engine at 44.1/48 kHz on 88.2 to 192 kHz files,\n"
+                             "                         resampling around it\n"
+                             "  --block=<samples>      processing block size (default 4096)\n"
+                             "  --bits=<depth>         output bit depth (default: same as the input)\n"
+                             "  --threads=<count>      worker threads (default: one per core)\n"
+                             "  --segment=<seconds>    also split files longer than this into segments rendered\n"
+                             "                         in parallel (default: every file in one pass); segmented\n"
+                             "                         output differs slightly from a one-pass render around\n"
+                             "                         each boundary\n"
+                             "  --profile=<file>       write per-stage timings as JSON (profiling builds only)\n"
+                             "The output format follows the output file's extension. The thread count\n"
+                             "never changes the result, only how fast it arrives.",
+                             renderFiles });
+
+    return app.findAndRunCommand (argc, argv);
+}
@@ -0,0 +1,148 @@
+#include "OfflineRenderer.h"
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer (const RenderSettings& settingsToUse)
+    : settings (settingsToUse)
+{
+    settings.blockSize = juce::jmax (16, settings.blockSize);
+    formatManager.registerBasicFormats();
+
+    setParameter (PitchMorpherAudioProcessor::PITCH_ID, settings.pitchSemitones);
+    setParameter (PitchMorpherAudioProcessor::FORMANT_ID, settings.formantSemitones);
+    setParameter (PitchMorpherAudioProcessor::MIX_ID, settings.mixPercent);
+    setParameter (PitchMorpherAudioProcessor::QUALITY_ID, (float) settings.quality);
+
+    const auto numHarmonies = juce::jmin (settings.harmonySemitones.size(), PitchMorpherAudioProcessor::maxVoices - 1);
+    setParameter (PitchMorpherAudioProcessor::VOICES_ID, (float) numHarmonies);
+
+    for (int i = 0; i < numHarmonies; ++i)
+        setParameter (PitchMorpherAudioProcessor::getVoiceParameterID (i + 1, "pitch"), settings.harmonySemitones[i]);
+
+    setParameter (PitchMorpherAudioProcessor::CORRECTION_ID, settings.correctionKey >= 0 ? 1.0f : 0.0f);
+    setParameter (PitchMorpherAudioProcessor::KEY_ID, (float) juce::jmax (0, settings.correctionKey));
+    setParameter (PitchMorpherAudioProcessor::SCALE_ID, (float) settings.correctionScale);
+    setParameter (PitchMorpherAudioProcessor::RETUNE_ID, settings.retuneMs);
+    setParameter (PitchMorpherAudioProcessor::INTERNAL_RATE_ID, settings.internalRate ? 1.0f : 0.0f);
+
+    processor.setNonRealtime (true);
+}
+
+void OfflineRenderer::setParameter (const juce::String& parameterID, float value)
+{
+    if (auto* parameter = processor.parameters.getParameter (parameterID))
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+}
+
+int OfflineRenderer::chooseBitDepth (juce::AudioFormat& format, int wanted) const
+{
+    const auto possible = format.getPossibleBitDepths();
+
+    if (possible.contains (wanted))
+        return wanted;
+
+    // Otherwise the deepest the format can write
+    return possible.isEmpty() ? 24 : possible.getLast();
+}
+
+//==============================================================================
+std::unique_ptr<juce::AudioFormatReader> OfflineRenderer::createReader (const juce::File& input)
+{
+    return std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor (input));
+}
+
+juce::Result OfflineRenderer::createWriter (const juce::File& output, const juce::AudioFormatReader& source,
+                                            int bitDepth, std::unique_ptr<juce::AudioFormatWriter>& writer)
+{
+    auto* format = formatManager.findFormatForFileExtension (output.getFileExtension());
+
+    if (format == nullptr)
+        return juce::Result::fail ("Don't know how to write " + output.getFileExtension() + " files");
+
+    if (bitDepth <= 0)
+        bitDepth = settings.bitDepth > 0 ? settings.bitDepth : (int) source.bitsPerSample;
+
+    output.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream (output.createOutputStream());
+
+    if (stream == nullptr)
+        return juce::Result::fail ("Can't write " + output.getFullPathName());
+
+    writer.reset (format->createWriterFor (stream.get(), source.sampleRate, source.numChannels,
+                                           chooseBitDepth (*format, bitDepth), source.metadataValues, 0));
+
+    if (writer == nullptr)
+        return juce::Result::fail ("Can't write " + output.getFullPathName() + " in that format");
+
+    stream.release(); // The writer owns it now
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result OfflineRenderer::render (const juce::File& input, const juce::File& output)
+{
+    auto reader = createReader (input);
+
+    if (reader == nullptr)
+        return juce::Result::fail ("Can't read " + input.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    auto result = createWriter (output, *reader, 0, writer);
+
+    if (result.wasOk())
+        result = renderRange (*reader, *writer, 0, reader->lengthInSamples, 0);
+
+    return result;
+}
+
+juce::Result OfflineRenderer::renderRange (juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer,
+                                           juce::int64 startSample, juce::int64 numSamples, juce::int64 preRoll)
+{
+    const auto numChannels = (int) reader.numChannels;
+    const auto sampleRate = reader.sampleRate;
+
+    // Run the processor with the file's own channel layout
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add (juce::AudioChannelSet::canonicalChannelSet (numChannels));
+    layout.outputBuses.add (juce::AudioChannelSet::canonicalChannelSet (numChannels));
+
+    if (! processor.setBusesLayout (layout))
+        return juce::Result::fail (juce::String (numChannels) + " channels isn't a supported layout");
+
+    processor.setRateAndBufferSizeDetails (sampleRate, settings.blockSize);
+    processor.prepareToPlay (sampleRate, settings.blockSize);
+
+    // Output sample t comes out `latency` samples after input sample t went in.
+    // Everything before startSample is the engine filling up: drop it, and keep
+    // feeding silence past the end of the file until the last wanted sample is out.
+    const auto latency = (juce::int64) processor.getLatencySamples();
+    const auto endSample = startSample + numSamples;
+    auto readPosition = juce::jmax ((juce::int64) 0, startSample - preRoll);
+    auto written = (juce::int64) 0;
+
+    while (written < numSamples)
+    {
+        const auto numThisTime = (int) juce::jmin ((juce::int64) settings.blockSize, endSample + latency - readPosition);
+
+        block.setSize (numChannels, numThisTime, false, false, true);
+
+        // Reads beyond the end of the file come back as silence
+        reader.read (&block, 0, numThisTime, readPosition, true, true);
+        processor.processBlock (block, midi);
+
+        const auto firstOutputSample = readPosition - latency;
+        const auto numToSkip = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numThisTime, startSample - firstOutputSample);
+        const auto numToWrite = (int) juce::jmin ((juce::int64) (numThisTime - numToSkip), numSamples - written);
+
+        if (numToWrite > 0 && ! writer.writeFromAudioSampleBuffer (block, numToSkip, numToWrite))
+        {
+            processor.releaseResources();
+            return juce::Result::fail ("Error writing audio");
+        }
+
+        readPosition += numThisTime;
+        written += juce::jmax (0, numToWrite);
+    }
+
+    processor.releaseResources();
+    return juce::Result::ok();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/** What to apply to a file, in the same units as the plugin's parameters. */
+struct RenderSettings
+{
+    float pitchSemitones = 0.0f;    // -24 to +24
+    float formantSemitones = 0.0f;  // -12 to +12
+    float mixPercent = 100.0f;      // 0 to 100
+    int quality = (int) PitchShiftEngine::Quality::ultra;  // offline renders default to the highest tier
+    juce::Array<float> harmonySemitones;   // pitches of extra voices, from the same analysis
+    int correctionKey = -1;         // 0 (C) to 11 (B) snaps the pitch to a scale, -1 leaves it alone
+    int correctionScale = (int) PitchTracker::Scale::chromatic;
+    float retuneMs = 50.0f;         // glide time to the corrected note
+    bool internalRate = false;      // run the engine at 44.1/48 kHz for high-rate files
+    int blockSize = 4096;           // samples per processBlock call
+    int bitDepth = 0;               // 0 keeps the input's bit depth
+};
+
+//==============================================================================
+/**
+    Renders audio files through PitchMorpherAudioProcessor without a host.
+
+    The file is streamed through fixed-size blocks, so memory use is the same
+    whatever its length. The processor runs in non-realtime mode, which always
+    selects the high-quality engine; its latency is trimmed from the start of the
+    output and flushed from the end, so the result lines up with the input
+    sample for sample and has the same length.
+
+    One renderer owns one processor and can render any number of files or ranges
+    in turn. Every render starts from a freshly prepared processor, so the result
+    never depends on what the renderer did before.
+*/
+class OfflineRenderer
+{
+public:
+    //==============================================================================
+    explicit OfflineRenderer (const RenderSettings& settingsToUse);
+
+    /** Renders input into output, in the format implied by output's extension
+        (.wav, .aif/.aiff or .flac). Overwrites output if it exists.
+    */
+    juce::Result render (const juce::File& input, const juce::File& output);
+
+    /** Renders output samples [startSample, startSample + numSamples) of reader's
+        file into writer. Processing starts preRoll samples earlier (or at the start
+        of the file) and that output is discarded, so the engine has settled by
+        startSample.
+    */
+    juce::Result renderRange (juce::AudioFormatReader& reader, juce::AudioFormatWriter& writer,
+                              juce::int64 startSample, juce::int64 numSamples, juce::int64 preRoll);
+
+    /** Opens a file with any of the registered formats. */
+    std::unique_ptr<juce::AudioFormatReader> createReader (const juce::File& input);
+
+    /** Creates a writer for output, in the format implied by its extension, matching
+        source's rate and channels. A bitDepth of 0 uses the settings' bit depth, or
+        else the source's.
+    */
+    juce::Result createWriter (const juce::File& output, const juce::AudioFormatReader& source,
+                               int bitDepth, std::unique_ptr<juce::AudioFormatWriter>& writer);
+
+    /** Stage timings of every render so far (empty unless built with PITCHMORPHER_PROFILING). */
+    const StageProfiler& getProfiler() const noexcept   { return processor.getProfiler(); }
+
+private:
+    //==============================================================================
+    void setParameter (const juce::String& parameterID, float value);
+    int chooseBitDepth (juce::AudioFormat& format, int wanted) const;
+
+    RenderSettings settings;
+    juce::AudioFormatManager formatManager;
+    PitchMorpherAudioProcessor processor;
+    juce::AudioBuffer<float> block;
+    juce::MidiBuffer midi;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
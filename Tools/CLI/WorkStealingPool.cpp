@@ -0,0 +1,117 @@
+#include "WorkStealingPool.h"
+
+//==============================================================================
+WorkStealingPool::WorkStealingPool (int numWorkers)
+{
+    for (int i = 0; i < juce::jmax (1, numWorkers); ++i)
+        workers.push_back (std::make_unique<Worker>());
+
+    // Start the threads only once every queue exists, since any of them may steal
+    for (size_t i = 0; i < workers.size(); ++i)
+        workers[i]->thread = std::thread ([this, i] { run ((int) i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    waitUntilIdle();
+
+    {
+        const std::lock_guard<std::mutex> sl (stateLock);
+        shouldExit = true;
+    }
+
+    workAvailable.notify_all();
+
+    for (auto& worker : workers)
+        worker->thread.join();
+}
+
+//==============================================================================
+void WorkStealingPool::addJob (Job job)
+{
+    auto& worker = *workers[(size_t) (nextQueue++ % (int) workers.size())];
+
+    {
+        const std::lock_guard<std::mutex> sl (stateLock);
+        ++numQueued;
+        ++numUnfinished;
+    }
+
+    {
+        const std::lock_guard<std::mutex> wl (worker.lock);
+        worker.jobs.push_back (std::move (job));
+    }
+
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::waitUntilIdle()
+{
+    std::unique_lock<std::mutex> sl (stateLock);
+    allDone.wait (sl, [this] { return numUnfinished == 0; });
+}
+
+//==============================================================================
+bool WorkStealingPool::takeJob (int workerIndex, Job& job)
+{
+    const auto numWorkers = (int) workers.size();
+
+    // Own queue first (newest job, whose data is most likely still in cache),
+    // then the oldest job of each other worker in turn
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto& worker = *workers[(size_t) ((workerIndex + i) % numWorkers)];
+        const std::lock_guard<std::mutex> wl (worker.lock);
+
+        if (worker.jobs.empty())
+            continue;
+
+        if (i == 0)
+        {
+            job = std::move (worker.jobs.back());
+            worker.jobs.pop_back();
+        }
+        else
+        {
+            job = std::move (worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void WorkStealingPool::run (int workerIndex)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> sl (stateLock);
+            workAvailable.wait (sl, [this] { return shouldExit || numQueued > 0; });
+
+            if (numQueued == 0)
+                return;
+
+            // Claim a job before looking for it, so idle workers don't all race for the last one
+            --numQueued;
+        }
+
+        Job job;
+
+        // A claimed job is always in some queue, though another worker may be
+        // between claiming and taking its own, so keep looking until it turns up
+        while (! takeJob (workerIndex, job))
+            std::this_thread::yield();
+
+        job (workerIndex);
+
+        {
+            const std::lock_guard<std::mutex> sl (stateLock);
+
+            if (--numUnfinished == 0)
+                allDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+//==============================================================================
+/**
+    Fixed set of worker threads, each with its own job queue.
+
+    Jobs are dealt out to the workers' queues in turn. A worker takes jobs from the
+    back of its own queue and, when that runs dry, steals from the front of the
+    others', so a worker that drew short jobs helps with the long ones instead of
+    sitting idle. Each job is told which worker runs it, so per-worker state (such
+    as one processor per worker) needs no locking.
+*/
+class WorkStealingPool
+{
+public:
+    //==============================================================================
+    using Job = std::function<void (int workerIndex)>;
+
+    explicit WorkStealingPool (int numWorkers);
+
+    /** Waits for the queued jobs to finish, then stops the workers. */
+    ~WorkStealingPool();
+
+    /** Queues a job; it may run on any worker. Safe to call from inside a job. */
+    void addJob (Job job);
+
+    /** Blocks until every queued job has finished. */
+    void waitUntilIdle();
+
+    int getNumWorkers() const noexcept                  { return (int) workers.size(); }
+
+private:
+    //==============================================================================
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Job> jobs;
+        std::thread thread;
+    };
+
+    void run (int workerIndex);
+    bool takeJob (int workerIndex, Job& job);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> nextQueue { 0 };
+
+    std::mutex stateLock;
+    std::condition_variable workAvailable, allDone;
+    int numQueued = 0, numUnfinished = 0;
+    bool shouldExit = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkStealingPool)
+};
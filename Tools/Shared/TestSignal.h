@@ -0,0 +1,37 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Fills the buffer with the tools' deterministic test signal: a few detuned
+    saws plus a little noise, dense enough that every bin is busy, never silent
+    (so no instance goes idle on it), and identical from run to run.
+
+    Shared by the benchmark and the stress host so their loads stay comparable.
+*/
+inline void fillTestSignal (juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+    juce::Random random (0x5eed);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+        auto* data = buffer.getWritePointer (ch);
+        double phases[3] = {};
+        const double frequencies[3] = { 110.0, 220.0 * 1.003, 330.0 * (1.0 + 0.002 * ch) };
+
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            float sample = 0.02f * (random.nextFloat() * 2.0f - 1.0f);
+
+            for (int v = 0; v < 3; ++v)
+            {
+                sample += 0.2f * (float) (2.0 * phases[v] - 1.0);
+                phases[v] += frequencies[v] / sampleRate;
+                phases[v] -= std::floor (phases[v]);
+            }
+
+            data[i] = sample;
+        }
+    }
+}
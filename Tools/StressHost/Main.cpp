@@ -0,0 +1,457 @@
+#include <JuceHeader.h>
+#include "TestSignal.h"
+#include <cstdio>
+#include <iostream>
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+//==============================================================================
+/*
+    Loads N instances of a plugin into one process through
+    juce::AudioPluginFormatManager, as a host would, and drives them from
+    realtime-paced callback threads, for a growing list of N.
+
+    The instances are dealt round-robin to the threads. Each thread wakes on a
+    fixed grid of block periods, processes its instances one after another and
+    counts an xrun whenever the callback ends after the period it was due in
+    (a device would have played a dropout), skipping the periods it overran.
+    Every count reports load time, resident memory per instance and the
+    callback times against the period, so the largest count without xruns is
+    the ceiling for the machine. No editor is ever created, so it runs
+    without a display.
+*/
+namespace
+{
+    struct StressSettings
+    {
+        juce::String plugin;
+        double sampleRate = 48000.0;
+        int blockSize = 256;
+        int numChannels = 2;
+        int numThreads = 1;
+        float pitch = 7.0f;
+        double seconds = 10.0;
+    };
+
+    struct StressResult
+    {
+        int numInstances = 0;
+        double loadMilliseconds = 0.0;
+        juce::int64 residentBytes = 0, bytesPerInstance = 0;
+        juce::int64 numCallbacks = 0, numXruns = 0;
+        double meanCallbackMicroseconds = 0.0, p99CallbackMicroseconds = 0.0, worstCallbackMicroseconds = 0.0;
+        double periodMicroseconds = 0.0;
+    };
+
+    //==============================================================================
+    /** Resident set size of this process, or 0 where it can't be read. */
+    juce::int64 getResidentBytes()
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        // Second field of statm: resident pages. Read with stdio, as procfs files
+        // report a length of 0 and juce::File would read nothing.
+        long long totalPages = 0, residentPages = 0;
+
+        if (auto* statm = std::fopen ("/proc/self/statm", "r"))
+        {
+            if (std::fscanf (statm, "%lld %lld", &totalPages, &residentPages) != 2)
+                residentPages = 0;
+
+            std::fclose (statm);
+        }
+
+        return (juce::int64) residentPages * (juce::int64) sysconf (_SC_PAGESIZE);
+       #elif JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS)
+            return (juce::int64) info.resident_size;
+
+        return 0;
+       #else
+        return 0;
+       #endif
+    }
+
+    /** Sets a parameter by its name, through the plugin's own text parsing, so it
+        works the same whatever IDs the format gives the parameters.
+    */
+    bool setParameter (juce::AudioPluginInstance& instance, const juce::String& name, float value)
+    {
+        for (auto* parameter : instance.getParameters())
+        {
+            if (parameter->getName (256) == name)
+            {
+                parameter->setValueNotifyingHost (parameter->getValueForText (juce::String (value)));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //==============================================================================
+    /** One simulated device callback, running its share of the instances. */
+    class CallbackThread  : public juce::Thread
+    {
+    public:
+        CallbackThread (int index, std::vector<juce::AudioPluginInstance*> instancesToRun, const StressSettings& settingsToUse,
+                        const juce::AudioBuffer<float>& sourceToUse, juce::int64 startTicks, juce::int64 endTicks)
+            : juce::Thread ("Stress callback " + juce::String (index)),
+              instances (std::move (instancesToRun)), settings (settingsToUse), source (sourceToUse),
+              block (settingsToUse.numChannels, settingsToUse.blockSize),
+              firstDeadline (startTicks), lastDeadline (endTicks),
+              periodTicks (juce::Time::secondsToHighResolutionTicks (settingsToUse.blockSize / settingsToUse.sampleRate))
+        {
+            callbackTicks.reserve ((size_t) ((lastDeadline - firstDeadline) / juce::jmax ((juce::int64) 1, periodTicks) + 1));
+        }
+
+        void run() override
+        {
+            const auto sourceBlocks = source.getNumSamples() / settings.blockSize;
+            auto deadline = firstDeadline;
+
+            for (int cycle = 0; deadline + periodTicks <= lastDeadline && ! threadShouldExit(); ++cycle)
+            {
+                waitUntil (deadline);
+
+                const auto sourceOffset = (cycle % sourceBlocks) * settings.blockSize;
+                const auto begin = juce::Time::getHighResolutionTicks();
+
+                for (auto* instance : instances)
+                {
+                    for (int ch = 0; ch < settings.numChannels; ++ch)
+                        block.copyFrom (ch, 0, source, ch, sourceOffset, settings.blockSize);
+
+                    instance->processBlock (block, midi);
+                }
+
+                const auto end = juce::Time::getHighResolutionTicks();
+                callbackTicks.push_back (end - begin);
+
+                // Due by the start of the next period; a late one is a dropout, and the
+                // periods it ran over are lost, as they would be on a device
+                deadline += periodTicks;
+
+                if (end > deadline)
+                {
+                    ++numXruns;
+                    deadline += ((end - deadline) / periodTicks + 1) * periodTicks;
+                }
+            }
+        }
+
+        std::vector<juce::int64> callbackTicks;
+        juce::int64 numXruns = 0;
+
+    private:
+        void waitUntil (juce::int64 ticks)
+        {
+            // Sleep most of the way, then yield for the last couple of milliseconds,
+            // as sleeps overshoot by far more than a short period allows
+            const auto spinTicks = juce::Time::secondsToHighResolutionTicks (0.002);
+
+            for (;;)
+            {
+                const auto remaining = ticks - juce::Time::getHighResolutionTicks();
+
+                if (remaining <= 0)
+                    return;
+
+                if (remaining > spinTicks)
+                    juce::Thread::sleep (1);
+                else
+                    juce::Thread::yield();
+            }
+        }
+
+        std::vector<juce::AudioPluginInstance*> instances;
+        const StressSettings& settings;
+        const juce::AudioBuffer<float>& source;
+        juce::AudioBuffer<float> block;
+        juce::MidiBuffer midi;
+        const juce::int64 firstDeadline, lastDeadline, periodTicks;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackThread)
+    };
+
+    //==============================================================================
+    std::unique_ptr<juce::AudioPluginInstance> createInstance (juce::AudioPluginFormatManager& formatManager,
+                                                               const juce::PluginDescription& description,
+                                                               const StressSettings& settings)
+    {
+        juce::String error;
+        auto instance = formatManager.createPluginInstance (description, settings.sampleRate, settings.blockSize, error);
+
+        if (instance == nullptr)
+            juce::ConsoleApplication::fail ("Can't create " + description.name + ": " + error);
+
+        auto layout = instance->getBusesLayout();
+        const auto channelSet = juce::AudioChannelSet::canonicalChannelSet (settings.numChannels);
+
+        if (! layout.inputBuses.isEmpty())
+            layout.inputBuses.getReference (0) = channelSet;
+
+        if (! layout.outputBuses.isEmpty())
+            layout.outputBuses.getReference (0) = channelSet;
+
+        if (! instance->setBusesLayout (layout))
+            juce::ConsoleApplication::fail (description.name + " doesn't support " + juce::String (settings.numChannels) + " channels");
+
+        // With no shift, instances would go idle and measure nothing
+        if (! setParameter (*instance, "Pitch Shift", settings.pitch))
+            std::cerr << "No \"Pitch Shift\" parameter; running with the plugin's defaults" << std::endl;
+
+        instance->setNonRealtime (false);
+        instance->prepareToPlay (settings.sampleRate, settings.blockSize);
+        return instance;
+    }
+
+    StressResult runCount (juce::AudioPluginFormatManager& formatManager, const juce::PluginDescription& description,
+                           const StressSettings& settings, int numInstances, const juce::AudioBuffer<float>& source)
+    {
+        StressResult result;
+        result.numInstances = numInstances;
+        result.periodMicroseconds = settings.blockSize * 1.0e6 / settings.sampleRate;
+
+        const auto residentBefore = getResidentBytes();
+        const auto loadStart = juce::Time::getHighResolutionTicks();
+
+        std::vector<std::unique_ptr<juce::AudioPluginInstance>> instances;
+
+        for (int i = 0; i < numInstances; ++i)
+            instances.push_back (createInstance (formatManager, description, settings));
+
+        result.loadMilliseconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - loadStart) * 1000.0;
+        result.residentBytes = getResidentBytes();
+        result.bytesPerInstance = (result.residentBytes - residentBefore) / numInstances;
+
+        // Deal the instances out and start every thread on the same period grid, a
+        // little in the future so they're all waiting when it begins
+        const auto numThreads = juce::jlimit (1, numInstances, settings.numThreads);
+        std::vector<std::vector<juce::AudioPluginInstance*>> shares ((size_t) numThreads);
+
+        for (int i = 0; i < numInstances; ++i)
+            shares[(size_t) (i % numThreads)].push_back (instances[(size_t) i].get());
+
+        const auto startTicks = juce::Time::getHighResolutionTicks() + juce::Time::secondsToHighResolutionTicks (0.1);
+        const auto endTicks = startTicks + juce::Time::secondsToHighResolutionTicks (settings.seconds);
+
+        juce::OwnedArray<CallbackThread> threads;
+
+        for (int t = 0; t < numThreads; ++t)
+        {
+            auto* thread = threads.add (new CallbackThread (t, std::move (shares[(size_t) t]), settings, source, startTicks, endTicks));
+
+            if (! thread->startRealtimeThread (juce::Thread::RealtimeOptions{}.withPriority (9)))
+                thread->startThread (juce::Thread::Priority::highest);
+        }
+
+        std::vector<juce::int64> callbackTicks;
+
+        for (auto* thread : threads)
+        {
+            thread->waitForThreadToExit (-1);
+            callbackTicks.insert (callbackTicks.end(), thread->callbackTicks.begin(), thread->callbackTicks.end());
+            result.numXruns += thread->numXruns;
+        }
+
+        for (auto& instance : instances)
+            instance->releaseResources();
+
+        if (callbackTicks.empty())
+            return result;
+
+        auto toMicroseconds = [] (juce::int64 ticks) { return juce::Time::highResolutionTicksToSeconds (ticks) * 1.0e6; };
+
+        juce::int64 totalTicks = 0;
+        for (auto ticks : callbackTicks)
+            totalTicks += ticks;
+
+        std::sort (callbackTicks.begin(), callbackTicks.end());
+
+        result.numCallbacks = (juce::int64) callbackTicks.size();
+        result.meanCallbackMicroseconds = toMicroseconds (totalTicks) / (double) result.numCallbacks;
+        result.p99CallbackMicroseconds = toMicroseconds (callbackTicks[(callbackTicks.size() - 1) * 99 / 100]);
+        result.worstCallbackMicroseconds = toMicroseconds (callbackTicks.back());
+        return result;
+    }
+
+    //==============================================================================
+    juce::var toJson (const StressResult& result)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("instances", result.numInstances);
+        object->setProperty ("loadMs", result.loadMilliseconds);
+        object->setProperty ("loadMsPerInstance", result.loadMilliseconds / result.numInstances);
+        object->setProperty ("residentBytes", result.residentBytes);
+        object->setProperty ("bytesPerInstance", result.bytesPerInstance);
+        object->setProperty ("callbacks", result.numCallbacks);
+        object->setProperty ("xruns", result.numXruns);
+        object->setProperty ("periodUs", result.periodMicroseconds);
+        object->setProperty ("meanCallbackUs", result.meanCallbackMicroseconds);
+        object->setProperty ("p99CallbackUs", result.p99CallbackMicroseconds);
+        object->setProperty ("worstCallbackUs", result.worstCallbackMicroseconds);
+        return juce::var (object);
+    }
+
+    juce::Array<int> getCountsOption (const juce::ArgumentList& args)
+    {
+        if (! args.containsOption ("--instances"))
+            return { 1, 8, 32, 64, 128, 192, 256, 300 };
+
+        juce::Array<int> counts;
+
+        for (auto& item : juce::StringArray::fromTokens (args.getValueForOption ("--instances"), ",", {}))
+            if (item.trim().getIntValue() > 0)
+                counts.add (item.trim().getIntValue());
+
+        if (counts.isEmpty())
+            juce::ConsoleApplication::fail ("--instances needs a comma-separated list of counts");
+
+        return counts;
+    }
+
+    juce::PluginDescription findPlugin (juce::AudioPluginFormatManager& formatManager, const juce::String& fileOrIdentifier)
+    {
+        juce::OwnedArray<juce::PluginDescription> types;
+
+        for (auto* format : formatManager.getFormats())
+            if (format->fileMightContainThisPluginType (fileOrIdentifier))
+                format->findAllTypesForFile (types, fileOrIdentifier);
+
+        if (types.isEmpty())
+            juce::ConsoleApplication::fail ("No VST3 or LV2 plugin found in " + fileOrIdentifier);
+
+        return *types.getFirst();
+    }
+
+    void runStressTest (const juce::ArgumentList& args)
+    {
+        StressSettings settings;
+        settings.plugin = args.containsOption ("--plugin") ? args.getValueForOption ("--plugin") : juce::String (PITCHMORPHER_DEFAULT_PLUGIN);
+
+        // Relative paths are taken from the working directory; anything else (an LV2
+        // URI) goes to the formats as it is
+        const auto relative = juce::File::getCurrentWorkingDirectory().getChildFile (settings.plugin);
+
+        if (! juce::File::isAbsolutePath (settings.plugin) && relative.exists())
+            settings.plugin = relative.getFullPathName();
+
+        settings.sampleRate = args.containsOption ("--rate") ? args.getValueForOption ("--rate").getDoubleValue() : settings.sampleRate;
+        settings.blockSize = args.containsOption ("--block") ? args.getValueForOption ("--block").getIntValue() : settings.blockSize;
+        settings.numChannels = args.containsOption ("--channels") ? args.getValueForOption ("--channels").getIntValue() : settings.numChannels;
+        settings.numThreads = args.containsOption ("--threads") ? args.getValueForOption ("--threads").getIntValue()
+                                                                : juce::jmax (1, juce::SystemStats::getNumPhysicalCpus());
+        settings.pitch = args.containsOption ("--pitch") ? args.getValueForOption ("--pitch").getFloatValue() : settings.pitch;
+        settings.seconds = args.containsOption ("--seconds") ? args.getValueForOption ("--seconds").getDoubleValue() : settings.seconds;
+
+        if (settings.sampleRate < 8000.0 || settings.blockSize < 16 || settings.numChannels < 1
+            || settings.numThreads < 1 || settings.seconds < 0.5)
+            juce::ConsoleApplication::fail ("Invalid settings; see --help");
+
+        juce::AudioPluginFormatManager formatManager;
+        formatManager.addDefaultFormats();
+
+        const auto description = findPlugin (formatManager, settings.plugin);
+        std::cerr << "Stressing " << description.name << " (" << description.pluginFormatName << ") at "
+                  << settings.sampleRate << " Hz, " << settings.blockSize << " samples, " << settings.numChannels
+                  << " channels, on " << settings.numThreads << " thread(s)" << std::endl;
+
+        // One second of source material, looped by every thread
+        const auto sourceBlocks = juce::jmax (1, (int) std::ceil (settings.sampleRate / settings.blockSize));
+        juce::AudioBuffer<float> source (settings.numChannels, sourceBlocks * settings.blockSize);
+        fillTestSignal (source, settings.sampleRate);
+
+        juce::Array<juce::var> resultsJson;
+        int ceiling = 0;
+
+        for (auto count : getCountsOption (args))
+        {
+            const auto result = runCount (formatManager, description, settings, count, source);
+
+            std::cerr << result.numInstances << " instances: " << result.numXruns << " xrun(s) in " << result.numCallbacks
+                      << " callbacks, worst " << juce::String (result.worstCallbackMicroseconds, 1) << " us of "
+                      << juce::String (result.periodMicroseconds, 1) << " us, "
+                      << juce::String (result.bytesPerInstance / 1024.0, 1) << " KiB and "
+                      << juce::String (result.loadMilliseconds / count, 2) << " ms to load per instance" << std::endl;
+
+            resultsJson.add (toJson (result));
+
+            if (result.numXruns == 0)
+                ceiling = juce::jmax (ceiling, count);
+        }
+
+        auto* machine = new juce::DynamicObject();
+        machine->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        machine->setProperty ("cores", juce::SystemStats::getNumCpus());
+        machine->setProperty ("physicalCores", juce::SystemStats::getNumPhysicalCpus());
+        machine->setProperty ("memoryMB", juce::SystemStats::getMemorySizeInMegabytes());
+        machine->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty ("plugin", description.name);
+        report->setProperty ("format", description.pluginFormatName);
+        report->setProperty ("version", description.version);
+        report->setProperty ("machine", juce::var (machine));
+        report->setProperty ("sampleRate", settings.sampleRate);
+        report->setProperty ("blockSize", settings.blockSize);
+        report->setProperty ("channels", settings.numChannels);
+        report->setProperty ("threads", settings.numThreads);
+        report->setProperty ("secondsPerCount", settings.seconds);
+        report->setProperty ("ceiling", ceiling);
+        report->setProperty ("results", resultsJson);
+
+        const auto json = juce::JSON::toString (juce::var (report));
+
+        if (args.containsOption ("--output"))
+        {
+            const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--output"));
+
+            if (! file.replaceWithText (json))
+                juce::ConsoleApplication::fail ("Can't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // Plugin formats create and release instances on the message thread; no
+    // window is ever opened
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h", "Usage: PitchMorpherStressHost [options]", false);
+
+    app.addDefaultCommand ({ "",
+                             "[options]",
+                             "Runs growing numbers of plugin instances in one process from realtime-paced\n"
+                             "callback threads, and reports xruns, callback times and memory as JSON",
+                             "Options:\n"
+                             "  --plugin=<file or id>  a VST3 bundle or LV2 plugin URI (default: the\n"
+                             "                         PitchMorpher VST3 built alongside)\n"
+                             "  --instances=<counts>   instance counts, comma-separated\n"
+                             "                         (default 1,8,32,64,128,192,256,300)\n"
+                             "  --threads=<count>      callback threads (default: one per physical core)\n"
+                             "  --rate=<hz>            sample rate (default 48000)\n"
+                             "  --block=<samples>      block size (default 256)\n"
+                             "  --channels=<count>     channels per instance (default 2)\n"
+                             "  --pitch=<semitones>    \"Pitch Shift\" of every instance (default 7)\n"
+                             "  --seconds=<seconds>    audio driven per count (default 10)\n"
+                             "  --output=<file>        write the JSON to a file instead of stdout\n"
+                             "\"ceiling\" in the report is the largest count that ran without an xrun.",
+                             runStressTest });
+
+    return app.findAndRunCommand (argc, argv);
+}